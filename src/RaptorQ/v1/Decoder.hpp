@@ -25,6 +25,7 @@
 #include "RaptorQ/v1/Octet.hpp"
 #include "RaptorQ/v1/Parameters.hpp"
 #include "RaptorQ/v1/Precode_Matrix.hpp"
+#include "RaptorQ/v1/Schedule.hpp"
 #include "RaptorQ/v1/Shared_Computation/Decaying_LF.hpp"
 #include "RaptorQ/v1/Thread_Pool.hpp"
 #include "RaptorQ/v1/util/Bitmask.hpp"
@@ -88,6 +89,8 @@ public:
     Error add_symbol (In_It &start, const In_It end, const uint32_t esi,
                                                                 bool padded);
     Decoder_Result decode (Work_State *thread_keep_working);
+    // eliminate the symbols as they arrive. see Precode_Matrix_Online.hpp
+    void set_online (const bool enable);
     DenseMtx* get_symbols();
     bool has_symbol (const uint16_t symbol) const;
 
@@ -110,6 +113,9 @@ public:
     std::vector<bool> fill_with_zeros();
 
 private:
+    Decoder_Result decode_online();
+    void init_online();
+
     bool keep_working, can_retry;
     const Save_Computation type;
     std::mutex lock;
@@ -118,6 +124,8 @@ private:
     Bitmask mask;
     DenseMtx source_symbols;
     std::vector<std::pair<uint32_t, Vect>> received_repair;
+    bool use_online = false;
+    std::unique_ptr<Precode_Matrix<Save_Computation::OFF>> online;
 
     // to help making things const
     static Save_Computation test_computation()
@@ -179,6 +187,43 @@ void Raw_Decoder<In_It>::clear_data()
     keep_working= true;
     mask = Bitmask (_symbols);
     received_repair.clear();
+    online.reset();
+    if (use_online)
+        init_online();
+}
+
+template <typename In_It>
+void Raw_Decoder<In_It>::set_online (const bool enable)
+{
+    std::lock_guard<std::mutex> guard (lock);
+    RQ_UNUSED(guard);
+    use_online = enable;
+    if (!use_online) {
+        online.reset();
+        return;
+    }
+    if (online == nullptr && mask.get_holes() != 0)
+        init_online();
+}
+
+template <typename In_It>
+void Raw_Decoder<In_It>::init_online()
+{
+    online = std::unique_ptr<Precode_Matrix<Save_Computation::OFF>> (
+                new Precode_Matrix<Save_Computation::OFF> (Parameters (
+                                                                _symbols)));
+    online->online_init (_symbols, static_cast<size_t> (
+                                                    source_symbols.cols()));
+    // catch up with what we already have
+    for (uint16_t esi = 0; esi < _symbols; ++esi) {
+        if (mask.exists (esi))
+            online->online_add (esi, row_data (source_symbols, esi));
+    }
+    const uint32_t padding = online->_params.K_padded - _symbols;
+    for (const auto &rep : received_repair) {
+        online->online_add (rep.first + padding,
+                    reinterpret_cast<const uint8_t*> (rep.second.data()));
+    }
 }
 
 template <typename In_It>
@@ -291,6 +336,8 @@ Error Raw_Decoder<In_It>::add_symbol (In_It &start, const In_It end,
                 return Error::WRONG_INPUT;
             }
         }
+        if (online != nullptr)
+            online->online_add (esi, row_data (source_symbols, esi));
     } else {
         Vect v = Vect (source_symbols.cols());
         for (; start != end && col != source_symbols.cols(); ++start) {
@@ -305,6 +352,10 @@ Error Raw_Decoder<In_It>::add_symbol (In_It &start, const In_It end,
         // for the symbol.
         if (col != v.cols())
             return Error::WRONG_INPUT;
+        if (online != nullptr) {
+            online->online_add (esi + (online->_params.K_padded - _symbols),
+                                reinterpret_cast<const uint8_t*> (v.data()));
+        }
         received_repair.emplace_back (esi, std::move(v));
         // reorder the received_repair:
         // ordering the repair packets lets us have more deterministic
@@ -353,6 +404,42 @@ std::vector<bool> Raw_Decoder<In_It>::fill_with_zeros()
     return ret;
 }
 
+template <typename In_It>
+Decoder_Result Raw_Decoder<In_It>::decode_online()
+{
+    // all the rows have already been eliminated, only the
+    // back-substitution is left: short enough to keep the lock.
+    std::lock_guard<std::mutex> guard (lock);
+    RQ_UNUSED(guard);
+    if (mask.get_holes() == 0)
+        return Decoder_Result::DECODED;
+    if (!can_retry)
+        return Decoder_Result::NEED_DATA;
+    can_retry = false;
+
+    Precode_Result precode_res;
+    DenseMtx missing;
+    std::tie (precode_res, missing) = online->online_solve (mask);
+    if (precode_res != Precode_Result::DONE)
+        return Decoder_Result::NEED_DATA;
+
+    uint16_t miss_row = 0;
+    for (uint16_t row = 0; row < _symbols &&
+                                            miss_row < missing.rows(); ++row) {
+        if (mask.exists (row))
+            continue;
+        source_symbols.row (row) = missing.row (miss_row);
+        ++miss_row;
+        mask.add (row);
+    }
+    keep_working = false;
+    // free some memory, until clear_data()
+    received_repair = std::vector<std::pair<uint32_t, Vect>>();
+    online.reset();
+    mask.free();
+    return Decoder_Result::DECODED;
+}
+
 template <typename In_It>
 Decoder_Result Raw_Decoder<In_It>::decode (Work_State *thread_keep_working)
 {
@@ -369,6 +456,9 @@ Decoder_Result Raw_Decoder<In_It>::decode (Work_State *thread_keep_working)
     if (received_repair.size() < mask.get_holes())
         return Decoder_Result::NEED_DATA;
 
+    if (online != nullptr)
+        return decode_online();
+
     const std::unique_ptr<Precode_Matrix< Save_Computation::ON>> precode_on (
                                                 init_precode_on (_symbols));
     const std::unique_ptr<Precode_Matrix<Save_Computation::OFF>> precode_off (
@@ -461,10 +551,10 @@ Decoder_Result Raw_Decoder<In_It>::decode (Work_State *thread_keep_working)
         auto compressed = DLF<std::vector<uint8_t>, Cache_Key>::
                                                             get()->get (key);
         auto decompressed = decompress (compressed.first, compressed.second);
-        DenseMtx precomputed = raw_to_Mtx (decompressed, key.out_size());
-        if (precomputed.rows() != 0) {
+        const Schedule precomputed = Schedule::from_raw (decompressed);
+        if (!precomputed.empty()) {
             DO_NOT_SAVE = true;
-            missing = precomputed * D;
+            missing = precomputed.replay (D);
             missing = precode_on->get_missing (std::move(missing), mask_safe);
         } else {
             std::tie (precode_res, missing) = precode_on->intermediate (D,
@@ -488,15 +578,10 @@ Decoder_Result Raw_Decoder<In_It>::decode (Work_State *thread_keep_working)
     D = DenseMtx(); // free some memory;
     if (type == Save_Computation::ON && !DO_NOT_SAVE &&
                                         precode_res == Precode_Result::DONE) {
-        DenseMtx res;
         if (missing.rows() != 0) {
-            const int32_t mt_size = static_cast<int32_t>(L_rows + overhead);
-            res.setIdentity (mt_size, mt_size);
-            for (const auto &op : ops)
-                op.build_mtx (res);
-            // TODO: lots of wasted ram? how to compress things directly?
-            auto raw_mtx = Mtx_to_raw (res);
-            auto compressed = compress (raw_mtx);
+            const uint32_t mt_size = L_rows + overhead;
+            auto raw = Schedule (ops, mt_size).to_raw();
+            auto compressed = compress (raw);
             DLF<std::vector<uint8_t>, Cache_Key>::get()->add (compressed.first,
                                                         compressed.second, key);
         }
@@ -27,12 +27,19 @@
 #include "RaptorQ/v1/Parameters.hpp"
 #include "RaptorQ/v1/Precode_Matrix.hpp"
 #include "RaptorQ/v1/Rand.hpp"
+#include "RaptorQ/v1/Schedule.hpp"
 #include "RaptorQ/v1/Shared_Computation/Decaying_LF.hpp"
 #include "RaptorQ/v1/Thread_Pool.hpp"
 #include <Eigen/Dense>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iterator>
 #include <memory>
+#include <thread>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace RaptorQ__v1 {
 namespace Impl {
@@ -41,6 +48,97 @@ using with_interleaver    = std::true_type;
 using without_interleaver = std::false_type;
 
 
+// Encoding a big range of symbols: the calling thread and the pool
+// threads take the next chunk of symbols until there are none left.
+template <typename Precode>
+class RAPTORQ_LOCAL Range_Encoder
+{
+public:
+    Range_Encoder (const Precode &precode, const DenseMtx &C,
+                                    const uint32_t ISI, const uint32_t count,
+                                    uint8_t *output, const size_t stride)
+        : _precode (precode), _C (C), _ISI (ISI), _count (count),
+                                        _output (output), _stride (stride),
+                                        _chunks ((count + chunk - 1) / chunk)
+    {
+        _next = 0;
+        _done = 0;
+    }
+    Range_Encoder() = delete;
+    Range_Encoder (const Range_Encoder&) = delete;
+    Range_Encoder& operator= (const Range_Encoder&) = delete;
+    Range_Encoder (Range_Encoder&&) = delete;
+    Range_Encoder& operator= (Range_Encoder&&) = delete;
+    ~Range_Encoder() = default;
+
+    // symbols for each thread at a time
+    enum : uint32_t { chunk = 64 };
+
+    uint32_t chunks() const
+        { return _chunks; }
+
+    void run()
+    {
+        for (;;) {
+            const uint32_t idx = _next.fetch_add (1);
+            if (idx >= _chunks)
+                break;
+            const uint32_t first = idx * chunk;
+            _precode.encode (_C, _ISI + first,
+                                std::min (static_cast<uint32_t> (chunk),
+                                                            _count - first),
+                                            _output + first * _stride, _stride);
+            _done.fetch_add (1, std::memory_order_release);
+        }
+    }
+    void wait() const
+    {
+        while (_done.load (std::memory_order_acquire) < _chunks)
+            std::this_thread::yield();
+    }
+
+private:
+    const Precode &_precode;
+    const DenseMtx &_C;
+    const uint32_t _ISI, _count;
+    uint8_t *const _output;
+    const size_t _stride;
+    const uint32_t _chunks;
+    std::atomic<uint32_t> _next, _done;
+};
+
+template <typename Precode>
+class RAPTORQ_LOCAL Range_Encoder_Work final :
+                                        public RFC6330__v1::Impl::Pool_Work
+{
+public:
+    explicit Range_Encoder_Work (
+                        const std::shared_ptr<Range_Encoder<Precode>> &job)
+        : _job (job) {}
+    RFC6330__v1::Work_Exit_Status do_work (RaptorQ__v1::Work_State *state)
+                                                                    override
+    {
+        RQ_UNUSED (state);
+        _job->run();
+        return RFC6330__v1::Work_Exit_Status::DONE;
+    }
+    ~Range_Encoder_Work() override {}
+private:
+    const std::shared_ptr<Range_Encoder<Precode>> _job;
+};
+
+
+// iterators over contiguous memory, so we can just memcpy the data.
+// vector<bool> is not contiguous.
+template <typename It>
+struct RAPTORQ_LOCAL is_contiguous : std::integral_constant<bool,
+        std::is_pointer<It>::value ||
+        (!std::is_same<typename std::iterator_traits<It>::value_type,
+                                                                bool>::value &&
+         std::is_same<It, typename std::vector<typename
+                    std::iterator_traits<It>::value_type>::iterator>::value)>
+{};
+
 // NOTE: enabled_if methods
 // instead of having 3-4 really similar methods, we use enable_if
 // to enable or disable contructors and methods, so that you are forced
@@ -73,6 +171,16 @@ public:
         typename std::enable_if<!I::value, int>::type = 0>
     void set_data (Rnd_It *from, Rnd_It *to);
 
+    // online encoding: the source symbols ("_symbol_size" bytes each)
+    // arrive one at a time, in any order, instead of through set_data.
+    // we are ready() as soon as the last one has been added.
+    // only for NON-INTERLEAVED
+    template <typename R_It = Rnd_It,
+        typename F_It = Fwd_It, typename I = Interleaved,
+        typename std::enable_if<!I::value, int>::type = 0>
+    Error add_source_symbol (const Schedule &precomputed, const uint16_t esi,
+                                                        const uint8_t *data);
+
     // "Enc" will have two implementations, depending os whether the
     // interleaver was used or not.
     template <typename R_It = Rnd_It,
@@ -86,13 +194,13 @@ public:
 
 
     // for both interleaved and non-interleaved
-    DenseMtx get_precomputed (RaptorQ__v1::Work_State *thread_keep_working);
+    Schedule get_precomputed (RaptorQ__v1::Work_State *thread_keep_working);
 
     // interleaver-only, precomputed
     template <typename R_It = Rnd_It,
         typename F_It = Fwd_It, typename I = Interleaved,
         typename std::enable_if<I::value, int>::type = 0>
-    bool generate_symbols (const DenseMtx &precomputed);
+    bool generate_symbols (const Schedule &precomputed);
     // interleaver-only, non precomputed
     template <typename R_It = Rnd_It,
         typename F_It = Fwd_It, typename I = Interleaved,
@@ -105,7 +213,7 @@ public:
     template <typename R_It = Rnd_It,
         typename F_It = Fwd_It, typename I = Interleaved,
         typename std::enable_if<!I::value, int>::type = 0>
-    bool generate_symbols (const DenseMtx &precomputed,
+    bool generate_symbols (const Schedule &precomputed,
                                         const Rnd_It *from, const Rnd_It *to);
     // non-interleaved: requires source symbols. non-precomputed
     template <typename R_It = Rnd_It,
@@ -113,6 +221,15 @@ public:
         typename std::enable_if<!I::value, int>::type = 0>
     bool generate_symbols (RaptorQ__v1::Work_State *thread_keep_working,
                                         const Rnd_It *from, const Rnd_It *to);
+    // non-interleaved: many encoders with the same number of symbols,
+    // all with their data already set. Their source symbols are put side
+    // by side, so the schedule is replayed only once for all of them.
+    template <typename R_It = Rnd_It,
+        typename F_It = Fwd_It, typename I = Interleaved,
+        typename std::enable_if<!I::value, int>::type = 0>
+    static bool generate_batch (const Schedule &precomputed,
+                                            Raw_Encoder *const *encoders,
+                                            const size_t count);
 
 
     void stop();
@@ -120,6 +237,26 @@ public:
     void clear_data();
     bool ready() const;
 
+    // encode "count" symbols from "first_esi", "stride" bytes apart
+    // in "output". Source symbols too, from the intermediate symbols.
+    // returns the number of symbols written.
+    uint32_t encode_range (const uint32_t first_esi, const uint32_t count,
+                                uint8_t *output, const size_t stride) const;
+
+    // fixed repair set: the generator matrix G = E_repair * M, restricted
+    // to the source symbols, for the repair symbols K .. K + repairs - 1.
+    // With G those repair symbols come straight from the source symbols,
+    // without the intermediate symbols. G is cached and kept across
+    // clear_data(), since it does not depend on the data.
+    // "precomputed" can be empty if G is in the cache.
+    // only for NON-INTERLEAVED
+    template <typename R_It = Rnd_It,
+        typename F_It = Fwd_It, typename I = Interleaved,
+        typename std::enable_if<!I::value, int>::type = 0>
+    bool gen_generator (const Schedule &precomputed, const uint32_t repairs);
+    // can we get the symbol from G and the source symbols?
+    bool from_generator (const uint32_t ESI) const;
+
 private:
     const size_t _symbol_size;
     const uint16_t _symbols;
@@ -133,6 +270,23 @@ private:
 
     DenseMtx encoded_symbols;
 
+    // online encoding. C = M * D is linear in D, so each source symbol
+    // is added to the intermediate symbols with its column of M.
+    // When M is too big we keep D and replay the schedule at the end.
+    DenseMtx _online_M;     // row "esi": column S + H + esi of M
+    DenseMtx _online;       // partial intermediate symbols, or D
+    std::vector<bool> _online_have;
+    uint16_t _online_missing;
+    DenseMtx _generator;    // fixed repair set: repairs x K
+
+    // biggest part of M we keep in memory
+    enum : size_t { max_M_bytes = 64 * 1024 * 1024 };
+    // columns of the source symbols in each tile of encode_generator
+    enum : size_t { l2_bytes = 1024 * 1024,
+                    min_tile = 4096 };
+    // encode_range uses the thread pool from this many bytes
+    enum : size_t { min_parallel_bytes = 1024 * 1024 };
+
     // interleaved and non-interleaved functions. same signature, though.
     template <typename R_It = Rnd_It,
         typename F_It = Fwd_It, typename I = Interleaved,
@@ -150,6 +304,23 @@ private:
 
     size_t Enc_repair (const uint32_t ESI, Fwd_It &output,
                                                         const Fwd_It end) const;
+    size_t Enc_intermediate (const uint32_t ISI, Fwd_It &output,
+                                                        const Fwd_It end) const;
+    size_t Enc_generator (const uint32_t ESI, Fwd_It &output,
+                                                        const Fwd_It end) const;
+    template <typename Fn>
+    size_t Enc_write (const Fn &symbol, const size_t bytes, Fwd_It &output,
+                                                        const Fwd_It end) const;
+    // columns [first, first + count) of the source part of M
+    DenseMtx source_columns (const Schedule &precomputed,
+                                                    const uint16_t first,
+                                                    const uint16_t count) const;
+    uint32_t encode_generator (const uint32_t first, const uint32_t count,
+                                uint8_t *output, const size_t stride) const;
+    template <typename Precode>
+    uint32_t encode_range (const Precode &precode, const uint32_t first_esi,
+                                    const uint32_t count, uint8_t *output,
+                                                    const size_t stride) const;
     std::pair<uint16_t, uint16_t> init_ksh();
     static Save_Computation test_computation()
     {
@@ -170,7 +341,8 @@ Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::Raw_Encoder (const Block_Size symbols,
                                                        const size_t symbol_size)
     : _symbol_size (symbol_size), _symbols (static_cast<uint16_t> (symbols)),
     _type (test_computation()), precode_on  (nullptr), precode_off (nullptr),
-                        _interleaver (nullptr), _from (nullptr), _to (nullptr)
+                        _interleaver (nullptr), _from (nullptr), _to (nullptr),
+                                                            _online_missing (0)
 {
     IS_RANDOM(Rnd_It, "RaptorQ__v1::Impl::Encoder");
     IS_FORWARD(Fwd_It, "RaptorQ__v1::Impl::Encoder");
@@ -186,7 +358,8 @@ Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::Raw_Encoder (
       _symbols (static_cast<uint16_t> (interleaver->extended_symbols (sbn))),
       _SBN (sbn), _type (test_computation()),
       precode_on  (nullptr), precode_off (nullptr),
-     _interleaver (interleaver), _from (nullptr), _to (nullptr)
+     _interleaver (interleaver), _from (nullptr), _to (nullptr),
+                                                            _online_missing (0)
 {
     IS_RANDOM(Rnd_It, "RaptorQ__v1::Impl::Encoder");
     IS_FORWARD(Fwd_It, "RaptorQ__v1::Impl::Encoder");
@@ -216,10 +389,159 @@ void Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::set_data (Rnd_It *from,
     _to = to;
 }
 
+// NON-interleaved only
+template <typename Rnd_It, typename Fwd_It, typename Interleaved>
+template <typename R_It, typename F_It, typename I,
+                                typename std::enable_if<!I::value, int>::type>
+Error Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::add_source_symbol (
+                                                    const Schedule &precomputed,
+                                                    const uint16_t esi,
+                                                    const uint8_t *data)
+{
+    if (precomputed.empty() || precode_on == nullptr || data == nullptr)
+        return Error::INITIALIZATION;
+    if (ready())
+        return Error::NOT_NEEDED;
+    if (esi >= _symbols)
+        return Error::WRONG_INPUT;
+    const uint16_t S_H = precode_on->_params.S + precode_on->_params.H;
+    const uint16_t K_S_H = precode_on->_params.K_padded + S_H;
+    const uint16_t L = precode_on->_params.L;
+    const bool fold = static_cast<size_t> (L) * _symbols <= max_M_bytes;
+    if (_online_have.size() == 0) {
+        _online_have.assign (_symbols, false);
+        _online_missing = _symbols;
+        if (fold) {
+            _online_M = source_columns (precomputed, 0, _symbols).transpose();
+            _online.setZero (L, static_cast<int64_t> (_symbol_size));
+        } else {
+            _online.setZero (K_S_H, static_cast<int64_t> (_symbol_size));
+        }
+    }
+    if (_online_have[esi])
+        return Error::NOT_NEEDED;
+    _online_have[esi] = true;
+    --_online_missing;
+    if (fold) {
+        const uint8_t *column = row_data (_online_M, esi);
+        for (uint16_t row = 0; row < L; ++row)
+            GF256::add_mul (row_data (_online, row), data, column[row],
+                                                                _symbol_size);
+    } else {
+        std::memcpy (row_data (_online, S_H + esi), data, _symbol_size);
+    }
+    if (_online_missing == 0) {
+        if (fold) {
+            encoded_symbols = std::move (_online);
+        } else {
+            encoded_symbols = precomputed.replay (_online);
+        }
+        _online = DenseMtx();
+        _online_M = DenseMtx();
+        _online_have.clear();
+    }
+    return Error::NONE;
+}
+
+// NON-interleaved only
+template <typename Rnd_It, typename Fwd_It, typename Interleaved>
+template <typename R_It, typename F_It, typename I,
+                                typename std::enable_if<!I::value, int>::type>
+bool Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::gen_generator (
+                                                const Schedule &precomputed,
+                                                const uint32_t repairs)
+{
+    if (repairs == 0)
+        return false;
+    if (static_cast<uint32_t> (_generator.rows()) == repairs)
+        return true;
+    // we only need the parameters, do not generate the matrix.
+    if (precode_on == nullptr) {
+        precode_on = std::unique_ptr<Precode_Matrix<Save_Computation::ON>> (
+                new Precode_Matrix<Save_Computation::ON>(Parameters(_symbols)));
+    }
+    const uint16_t L = precode_on->_params.L;
+    // the repair bitmask is only there to tell the key from the others
+    const auto tmp_bool = std::vector<bool>();
+    const Cache_Key key (L, 0, repairs, tmp_bool,
+                                            std::vector<bool> (repairs, true));
+    const size_t bytes = static_cast<size_t> (repairs) * _symbols;
+    if (_type == Save_Computation::ON) {
+        auto compressed = DLF<std::vector<uint8_t>, Cache_Key>::
+                                                            get()->get (key);
+        if (compressed.second.size() != 0) {
+            auto raw = decompress (compressed.first, compressed.second);
+            if (raw.size() == bytes) {
+                _generator = DenseMtx (repairs, _symbols);
+                std::memcpy (row_data (_generator, 0), raw.data(), bytes);
+                return true;
+            }
+        }
+    }
+    if (precomputed.empty())
+        return false;
+    // each column of G is the encoding of the same column of M:
+    // encode a few columns of M at a time, as if they were symbols.
+    DenseMtx G (repairs, _symbols);
+    const uint32_t ISI = precode_on->_params.K_padded;
+    const uint16_t cols = static_cast<uint16_t> (std::max (
+                    static_cast<size_t> (1), std::min (
+                        static_cast<size_t> (_symbols), max_M_bytes / L)));
+    std::vector<uint8_t> part (static_cast<size_t> (repairs) * cols);
+    for (uint16_t first = 0; first < _symbols; first += cols) {
+        const uint16_t size = std::min (cols,
+                                    static_cast<uint16_t> (_symbols - first));
+        const DenseMtx M = source_columns (precomputed, first, size);
+        precode_on->encode (M, ISI, repairs, part.data(), size);
+        for (uint32_t row = 0; row < repairs; ++row) {
+            std::memcpy (row_data (G, row) + first,
+                        part.data() + static_cast<size_t> (row) * size, size);
+        }
+    }
+    _generator = std::move (G);
+    if (_type == Save_Computation::ON) {
+        std::vector<uint8_t> raw (bytes);
+        std::memcpy (raw.data(), row_data (_generator, 0), bytes);
+        auto compressed = compress (raw);
+        DLF<std::vector<uint8_t>, Cache_Key>::get()->add (compressed.first,
+                                                        compressed.second, key);
+    }
+    return true;
+}
+
+template <typename Rnd_It, typename Fwd_It, typename Interleaved>
+bool Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::from_generator (
+                                                    const uint32_t ESI) const
+{
+    return _from != nullptr && _to != nullptr && ESI >= _symbols &&
+                ESI - _symbols < static_cast<uint32_t> (_generator.rows());
+}
+
+template <typename Rnd_It, typename Fwd_It, typename Interleaved>
+DenseMtx Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::source_columns (
+                                                const Schedule &precomputed,
+                                                const uint16_t first,
+                                                const uint16_t count) const
+{
+    // C = M * D: replay the schedule on the unit vectors of the
+    // source symbols.
+    const uint16_t S_H = precode_on->_params.S + precode_on->_params.H;
+    const uint16_t K_S_H = precode_on->_params.K_padded + S_H;
+    DenseMtx E;
+    E.setZero (K_S_H, count);
+    for (uint16_t col = 0; col < count; ++col)
+        E (S_H + first + col, col) = Octet (1);
+    return precomputed.replay (E);
+}
+
 template <typename Rnd_It, typename Fwd_It, typename Interleaved>
 void Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::clear_data()
 {
     encoded_symbols = DenseMtx();
+    _online = DenseMtx();
+    _online_M = DenseMtx();
+    _online_have.clear();
+    _online_missing = 0;
     _interleaver = nullptr;
     _from = nullptr;
     _to = nullptr;
@@ -230,7 +552,7 @@ bool Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::ready() const
     { return encoded_symbols.cols() != 0; }
 
 template <typename Rnd_It, typename Fwd_It, typename Interleaved>
-DenseMtx Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::get_precomputed (
+Schedule Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::get_precomputed (
                                 RaptorQ__v1::Work_State *thread_keep_working)
 {
     keep_working = true;
@@ -247,11 +569,7 @@ DenseMtx Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::get_precomputed (
                                                             get()->get (key);
         if (compressed.second.size() != 0) {
             auto uncompressed = decompress (compressed.first,compressed.second);
-            DenseMtx precomputed = raw_to_Mtx (uncompressed, key.out_size());
-            if (precomputed.rows() != 0) {
-                return precomputed;
-            }
-            return DenseMtx();
+            return Schedule::from_raw (uncompressed);
         }
         // else not found, generate one.
     }
@@ -275,22 +593,18 @@ DenseMtx Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::get_precomputed (
                                                         ops, keep_working,
                                                         thread_keep_working);
     if (precode_res != Precode_Result::DONE || encoded_no_symbols.cols() == 0)
-        return DenseMtx();
+        return Schedule();
 
     // RaptorQ succeded.
-    // build the precomputed matrix.
-    DenseMtx res;
-    // don't save really small matrices.
+    // build the precomputed schedule.
 
     const uint16_t size = precode_on->_params.L;
     const auto tmp_bool = std::vector<bool>();
     const Cache_Key key (size, 0, 0, tmp_bool, tmp_bool);
-    res.setIdentity (size, size);
-    for (const auto &op : ops)
-        op.build_mtx (res);
+    Schedule res (ops, size);
     if (_type == Save_Computation::ON) {
-        auto raw_mtx = Mtx_to_raw (res);
-        auto compressed = compress (raw_mtx);
+        auto raw = res.to_raw();
+        auto compressed = compress (raw);
         DLF<std::vector<uint8_t>, Cache_Key>::get()->add (compressed.first,
                                                         compressed.second, key);
     }
@@ -316,6 +630,31 @@ DenseMtx Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::get_raw_symbols(
     uint16_t row = S_H;
 
     // now the C[0...K] symbols follow
+    if (is_contiguous<Rnd_It>::value) {
+        // copy all the full symbols at once, only the last one
+        // might need padding
+        const size_t bytes = static_cast<size_t> (*_to - *_from) * sizeof(T);
+        const uint16_t full = static_cast<uint16_t> (std::min (
+                        static_cast<size_t> (_symbols), bytes / _symbol_size));
+        const uint8_t *data = nullptr;
+        if (bytes != 0)
+            data = reinterpret_cast<const uint8_t*> (&**_from);
+        if (full != 0)
+            std::memcpy (row_data (D, row), data, full * _symbol_size);
+        row += full;
+        if (row < S_H + _symbols) {
+            const size_t last = bytes - full * _symbol_size;
+            if (last != 0) {
+                std::memcpy (row_data (D, row), data + full * _symbol_size,
+                                                                        last);
+            }
+            std::memset (row_data (D, row) + last, 0, _symbol_size - last);
+            ++row;
+        }
+        // symbols after the end of the data are all zero
+        D.block (row, 0, D.rows() - row, D.cols()).setZero();
+        return D;
+    }
     std::vector<uint8_t> padding (sizeof(T), 0);
     Rnd_It it = *_from;
     uint8_t *p = reinterpret_cast<uint8_t*> (&*it);
@@ -387,16 +726,16 @@ template <typename Rnd_It, typename Fwd_It, typename Interleaved>
 template <typename R_It, typename F_It, typename I,
                                 typename std::enable_if<I::value, int>::type>
 bool Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::generate_symbols (
-                                                    const DenseMtx &precomputed)
+                                                    const Schedule &precomputed)
 {
-    if (precomputed.rows() == 0)
+    if (precomputed.empty())
         return false;
     keep_working = true;
 
     const uint16_t S_H = precode_on->_params.S + precode_on->_params.H;
     const uint16_t K_S_H = precode_on->_params.K_padded + S_H;
     const DenseMtx D = get_raw_symbols (K_S_H, S_H);
-    encoded_symbols = precomputed * D;
+    encoded_symbols = precomputed.replay (D);
     return true;
 }
 
@@ -421,10 +760,10 @@ template <typename Rnd_It, typename Fwd_It, typename Interleaved>
 template <typename R_It, typename F_It, typename I,
                                 typename std::enable_if<!I::value, int>::type>
 bool Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::generate_symbols (
-                                        const DenseMtx &precomputed,
+                                        const Schedule &precomputed,
                                         const Rnd_It *from, const Rnd_It *to)
 {
-    if (precomputed.rows() == 0 || from == nullptr || to == nullptr)
+    if (precomputed.empty() || from == nullptr || to == nullptr)
         return false;
     keep_working = true;
 
@@ -434,7 +773,7 @@ bool Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::generate_symbols (
     const uint16_t K_S_H = precode_on->_params.K_padded + S_H;
 
     const DenseMtx D = get_raw_symbols (K_S_H, S_H);
-    encoded_symbols = precomputed * D;
+    encoded_symbols = precomputed.replay (D);
     return true;
 }
 
@@ -465,6 +804,63 @@ bool Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::generate_symbols (
 
 
 
+// GENERATE - NON interleaved, precomputed, many encoders at once
+template <typename Rnd_It, typename Fwd_It, typename Interleaved>
+template <typename R_It, typename F_It, typename I,
+                                typename std::enable_if<!I::value, int>::type>
+bool Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::generate_batch (
+                                                const Schedule &precomputed,
+                                                Raw_Encoder *const *encoders,
+                                                const size_t count)
+{
+    if (precomputed.empty() || encoders == nullptr || count == 0)
+        return false;
+    const Parameters params (encoders[0]->_symbols);
+    const uint16_t S_H = params.S + params.H;
+    const uint16_t K_S_H = params.K_padded + S_H;
+    size_t cols = 0;
+    for (size_t idx = 0; idx < count; ++idx) {
+        const Raw_Encoder *enc = encoders[idx];
+        if (enc->_symbols != encoders[0]->_symbols ||
+                                enc->_from == nullptr || enc->_to == nullptr) {
+            return false;
+        }
+        cols += enc->_symbol_size;
+    }
+    // one wide D, with the columns of each encoder one after the other
+    DenseMtx D (K_S_H, static_cast<int64_t> (cols));
+    size_t col = 0;
+    for (size_t idx = 0; idx < count; ++idx) {
+        const Raw_Encoder *enc = encoders[idx];
+        const DenseMtx part = enc->get_raw_symbols (K_S_H, S_H);
+        for (uint16_t row = 0; row < K_S_H; ++row) {
+            std::memcpy (row_data (D, row) + col, row_data (part, row),
+                                                            enc->_symbol_size);
+        }
+        col += enc->_symbol_size;
+    }
+    const DenseMtx C = precomputed.replay (D);
+    col = 0;
+    for (size_t idx = 0; idx < count; ++idx) {
+        Raw_Encoder *enc = encoders[idx];
+        // encoding only needs the parameters: no need to generate it.
+        if (enc->precode_on == nullptr) {
+            enc->precode_on = std::unique_ptr<
+                                    Precode_Matrix<Save_Computation::ON>> (
+                            new Precode_Matrix<Save_Computation::ON> (params));
+        }
+        enc->encoded_symbols = DenseMtx (C.rows(),
+                                    static_cast<int64_t> (enc->_symbol_size));
+        for (int64_t row = 0; row < C.rows(); ++row) {
+            std::memcpy (row_data (enc->encoded_symbols, row),
+                                    row_data (C, row) + col, enc->_symbol_size);
+        }
+        col += enc->_symbol_size;
+    }
+    return true;
+}
+
+
 template <typename Rnd_It, typename Fwd_It, typename Interleaved>
 std::pair<uint16_t, uint16_t> Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::
                                                                     init_ksh()
@@ -507,11 +903,11 @@ bool Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::compute_intermediate (
                                                             get()->get (key);
         if (compressed.second.size() != 0) {
             auto decompressed = decompress (compressed.first,compressed.second);
-            DenseMtx precomputed = raw_to_Mtx (decompressed, key.out_size());
-            if (precomputed.rows() != 0) {
-                // we have a precomputed matrix! let's use that!
-                encoded_symbols = precomputed * D;
-                // result is granted. we only save matrices that work
+            const Schedule precomputed = Schedule::from_raw (decompressed);
+            if (!precomputed.empty()) {
+                // we have a precomputed schedule! let's use that!
+                encoded_symbols = precomputed.replay (D);
+                // result is granted. we only save schedules that work
                 return true;
             }
         }
@@ -523,14 +919,10 @@ bool Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::compute_intermediate (
             return false;
 
         // RaptorQ succeded.
-        // build the precomputed matrix.
-        DenseMtx res;
+        // build the precomputed schedule.
         if (encoded_symbols.cols() != 0) {
-            res.setIdentity (size, size);
-            for (const auto &op : ops)
-                op.build_mtx (res);
-            auto raw_mtx = Mtx_to_raw (res);
-            compressed = compress (raw_mtx);
+            auto raw = Schedule (ops, size).to_raw();
+            compressed = compress (raw);
             DLF<std::vector<uint8_t>, Cache_Key>::get()->add (compressed.first,
                                                         compressed.second, key);
         }
@@ -611,8 +1003,12 @@ size_t Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::Enc (const uint32_t ESI,
     // The alignment of "Fwd_It" might *NOT* be the alignment of "Rnd_It"
 
     size_t written = 0;
-    if (_from == nullptr || _to == nullptr)
-        return written;
+    if (_from == nullptr || _to == nullptr) {
+        // online encoding: no source data, only the intermediate symbols
+        if (ESI < _symbols)
+            return Enc_intermediate (ESI, output, end);
+        return Enc_repair (ESI, output, end);
+    }
 
     if (ESI < _symbols) {
         // just return the source symbol.
@@ -671,8 +1067,11 @@ size_t Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::Enc_repair (const uint32_t ESI,
 {
     size_t written = 0;
     // repair symbol requested.
-    if (!ready())
+    if (!ready()) {
+        if (from_generator (ESI))
+            return Enc_generator (ESI, output, end);
         return written;
+    }
     uint16_t K;
     if (_type == Save_Computation::ON) {
         if (precode_on == nullptr)
@@ -688,26 +1087,75 @@ size_t Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::Enc_repair (const uint32_t ESI,
             K = precode_off->_params.K_padded;
         }
     }
-    auto ISI = ESI + (K - _symbols);
-    DenseMtx tmp;
-    if (_type == Save_Computation::ON) {
-        tmp = precode_on->encode (encoded_symbols, ISI);
-    } else {
-        if (precode_off == nullptr) {
-            // we were forced to use "precode_on". see earlier "if"
-            tmp = precode_on->encode (encoded_symbols, ISI);
+    return Enc_intermediate (ESI + (K - _symbols), output, end);
+}
+
+// any symbol, from the intermediate symbols
+template <typename Rnd_It, typename Fwd_It, typename Interleaved>
+size_t Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::Enc_intermediate (
+                                                        const uint32_t ISI,
+                                                        Fwd_It &output,
+                                                        const Fwd_It end) const
+{
+    if (!ready() || (precode_on == nullptr && precode_off == nullptr))
+        return 0;
+    // write the symbol in "out"
+    const auto symbol = [&] (uint8_t *out) {
+        if (_type == Save_Computation::ON || precode_off == nullptr) {
+            // with precode_off == nullptr we were forced to use
+            // "precode_on". see Enc_repair
+            precode_on->encode (encoded_symbols, ISI, out);
         } else {
-            tmp = precode_off->encode (encoded_symbols, ISI);
+            precode_off->encode (encoded_symbols, ISI, out);
         }
+    };
+    return Enc_write (symbol, static_cast<size_t> (encoded_symbols.cols()),
+                                                                output, end);
+}
+
+// repair symbol of the fixed set, from the source symbols
+template <typename Rnd_It, typename Fwd_It, typename Interleaved>
+size_t Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::Enc_generator (
+                                                        const uint32_t ESI,
+                                                        Fwd_It &output,
+                                                        const Fwd_It end) const
+{
+    const auto symbol = [&] (uint8_t *out) {
+        encode_generator (ESI - _symbols, 1, out, _symbol_size);
+    };
+    return Enc_write (symbol, _symbol_size, output, end);
+}
+
+// write the symbol "bytes" long that "symbol (uint8_t *out)" generates
+template <typename Rnd_It, typename Fwd_It, typename Interleaved>
+template <typename Fn>
+size_t Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::Enc_write (const Fn &symbol,
+                                                        const size_t bytes,
+                                                        Fwd_It &output,
+                                                        const Fwd_It end) const
+{
+    size_t written = 0;
+    using T = typename std::iterator_traits<Fwd_It>::value_type;
+    const size_t words = (bytes + sizeof(T) - 1) / sizeof(T);
+    if (std::is_pointer<Fwd_It>::value &&
+                static_cast<size_t> (std::distance (output, end)) >= words) {
+        // contiguous memory, with enough room: no temporaries.
+        uint8_t *out = reinterpret_cast<uint8_t *> (&*output);
+        symbol (out);
+        std::memset (out + bytes, 0, words * sizeof(T) - bytes);
+        std::advance (output, words);
+        return words;
     }
 
+    std::vector<uint8_t> tmp (bytes);
+    symbol (tmp.data());
+
     // put "tmp" in output, but the alignment is different
 
-    using T = typename std::iterator_traits<Fwd_It>::value_type;
     T al = static_cast<T> (0);
     uint8_t *p = reinterpret_cast<uint8_t *>  (&al);
-    for (int32_t i = 0; i < tmp.cols(); ++i) {
-        *p = static_cast<uint8_t> (tmp (0, i));
+    for (size_t i = 0; i < bytes; ++i) {
+        *p = tmp[i];
         ++p;
         if (p == reinterpret_cast<uint8_t *>  (&al) + sizeof(T)) {
             *output = al;
@@ -719,7 +1167,7 @@ size_t Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::Enc_repair (const uint32_t ESI,
                 return written;
         }
     }
-    if (p != reinterpret_cast<uint8_t *>  (&al) + sizeof(T)) {
+    if (p != reinterpret_cast<uint8_t *>  (&al)) {
         // symbol size is not aligned with Fwd_It type
         while (p != reinterpret_cast<uint8_t *>  (&al) + sizeof(T))
             *(p++) = 0;
@@ -730,5 +1178,154 @@ size_t Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::Enc_repair (const uint32_t ESI,
     return written;
 }
 
+// repair symbols [first, first + count) of the fixed set.
+// This is just G * D, with only the source symbols in D. We go through
+// the columns in tiles, so that the source symbols stay in cache
+// while we build all the repair symbols.
+template <typename Rnd_It, typename Fwd_It, typename Interleaved>
+uint32_t Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::encode_generator (
+                                                    const uint32_t first,
+                                                    const uint32_t count,
+                                                    uint8_t *output,
+                                                    const size_t stride) const
+{
+    using T = typename std::iterator_traits<Rnd_It>::value_type;
+    std::vector<const uint8_t*> src;
+    std::vector<uint16_t> col;  // column of G for each source symbol
+    src.reserve (_symbols);
+    col.reserve (_symbols);
+    DenseMtx D;
+    std::vector<uint8_t> last;
+    if (is_contiguous<Rnd_It>::value) {
+        // point to the data, only the last symbol might need padding.
+        // symbols after the end of the data are zero: skip them.
+        const size_t bytes = static_cast<size_t> (*_to - *_from) * sizeof(T);
+        const uint8_t *data = nullptr;
+        if (bytes != 0)
+            data = reinterpret_cast<const uint8_t*> (&**_from);
+        for (uint16_t k = 0; k < _symbols; ++k) {
+            const size_t from = static_cast<size_t> (k) * _symbol_size;
+            if (from >= bytes)
+                break;
+            if (bytes - from >= _symbol_size) {
+                src.push_back (data + from);
+            } else {
+                last.assign (_symbol_size, 0);
+                std::memcpy (last.data(), data + from, bytes - from);
+                src.push_back (last.data());
+            }
+            col.push_back (k);
+        }
+    } else {
+        const uint16_t S_H = precode_on->_params.S + precode_on->_params.H;
+        const uint16_t K_S_H = precode_on->_params.K_padded + S_H;
+        D = get_raw_symbols (K_S_H, S_H);
+        for (uint16_t k = 0; k < _symbols; ++k) {
+            src.push_back (row_data (D, S_H + k));
+            col.push_back (k);
+        }
+    }
+    const uint32_t sources = static_cast<uint32_t> (src.size());
+    std::vector<uint8_t> mul (static_cast<size_t> (count) * sources);
+    for (uint32_t sym = 0; sym < count; ++sym) {
+        const uint8_t *g = row_data (_generator, first + sym);
+        for (uint32_t s = 0; s < sources; ++s)
+            mul[sym * sources + s] = g[col[s]];
+        std::memset (output + sym * stride, 0, _symbol_size);
+    }
+    if (sources == 0)
+        return count;
+    size_t width = (l2_bytes / sources) & ~static_cast<size_t> (255);
+    width = std::min (_symbol_size,
+                            std::max (width, static_cast<size_t> (min_tile)));
+    std::vector<const uint8_t*> in (sources);
+    for (size_t from = 0; from < _symbol_size; from += width) {
+        const size_t len = std::min (width, _symbol_size - from);
+        for (uint32_t s = 0; s < sources; ++s)
+            in[s] = src[s] + from;
+        for (uint32_t sym = 0; sym < count; ++sym) {
+            GF256::add_mul_sum (output + sym * stride + from, in.data(),
+                                        mul.data() + sym * sources, sources,
+                                                                        len);
+        }
+    }
+    return count;
+}
+
+template <typename Rnd_It, typename Fwd_It, typename Interleaved>
+uint32_t Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::encode_range (
+                                                    const uint32_t first_esi,
+                                                    const uint32_t count,
+                                                    uint8_t *output,
+                                                    const size_t stride) const
+{
+    if (output == nullptr || stride < _symbol_size || count == 0)
+        return 0;
+    if (!ready()) {
+        // without intermediate symbols only the fixed repair set works
+        if (!from_generator (first_esi) ||
+                                    !from_generator (first_esi + count - 1)) {
+            return 0;
+        }
+        return encode_generator (first_esi - _symbols, count, output, stride);
+    }
+    if (_type == Save_Computation::ON || precode_off == nullptr) {
+        // we might have used the precode, and thus forced the "precode_on".
+        if (precode_on == nullptr)
+            return 0;
+        return encode_range (*precode_on, first_esi, count, output, stride);
+    }
+    return encode_range (*precode_off, first_esi, count, output, stride);
+}
+
+template <typename Rnd_It, typename Fwd_It, typename Interleaved>
+template <typename Precode>
+uint32_t Raw_Encoder<Rnd_It, Fwd_It, Interleaved>::encode_range (
+                                                    const Precode &precode,
+                                                    const uint32_t first_esi,
+                                                    const uint32_t count,
+                                                    uint8_t *output,
+                                                    const size_t stride) const
+{
+    // source symbols have ISI == ESI, repair symbols skip the padding.
+    uint32_t sources = 0;
+    if (first_esi < _symbols)
+        sources = std::min (count, _symbols - first_esi);
+    const uint32_t padding = precode._params.K_padded - _symbols;
+    const uint32_t ISIs[2] = { first_esi, first_esi + sources + padding };
+    const uint32_t sizes[2] = { sources, count - sources };
+    // big ranges are split on the thread pool.
+    // waiting threads spin: never use more threads than cores.
+    using Job = Range_Encoder<Precode>;
+    const uint32_t cores = std::thread::hardware_concurrency();
+    const size_t pool = RFC6330__v1::Impl::Thread_Pool::get().size();
+    for (uint8_t part = 0; part < 2; ++part) {
+        if (sizes[part] == 0)
+            continue;
+        uint8_t *out = output;
+        if (part == 1)
+            out += static_cast<size_t> (sources) * stride;
+        if (cores < 2 || pool == 0 || sizes[part] <= Job::chunk ||
+                        sizes[part] * _symbol_size < min_parallel_bytes) {
+            precode.encode (encoded_symbols, ISIs[part], sizes[part], out,
+                                                                    stride);
+            continue;
+        }
+        auto job = std::make_shared<Job> (precode, encoded_symbols,
+                                    ISIs[part], sizes[part], out, stride);
+        const uint32_t helpers = static_cast<uint32_t> (std::min (
+                            std::min (static_cast<size_t> (cores - 1), pool),
+                                    static_cast<size_t> (job->chunks() - 1)));
+        for (uint32_t helper = 0; helper < helpers; ++helper) {
+            RFC6330__v1::Impl::Thread_Pool::get().add_work (
+                        std::unique_ptr<RFC6330__v1::Impl::Pool_Work> (
+                                        new Range_Encoder_Work<Precode> (job)));
+        }
+        job->run();
+        job->wait();
+    }
+    return count;
+}
+
 }   // namespace Impl
 }   // namespace RFC6330__v1
@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2015-2016, Luca Fulchir<luca@fulchir.it>, All rights reserved.
+ *
+ * This file is part of "libRaptorQ".
+ *
+ * libRaptorQ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * libRaptorQ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * and a copy of the GNU Lesser General Public License
+ * along with libRaptorQ.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "RaptorQ/v1/common.hpp"
+#include "RaptorQ/v1/gf256.hpp"
+#include "RaptorQ/v1/Octet.hpp"
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace RaptorQ__v1 {
+namespace Impl {
+
+// index of the lowest set bit. word must not be zero.
+inline uint32_t ctz64 (const uint64_t word)
+{
+    #if defined(__GNUC__)
+    return static_cast<uint32_t> (__builtin_ctzll (word));
+    #else
+    uint32_t idx = 0;
+    while (((word >> idx) & 1) == 0)
+        ++idx;
+    return idx;
+    #endif
+}
+
+// number of set bits
+inline uint32_t popcount64 (uint64_t word)
+{
+    #if defined(__GNUC__)
+    return static_cast<uint32_t> (__builtin_popcountll (word));
+    #else
+    uint32_t count = 0;
+    for (; word != 0; word &= word - 1)
+        ++count;
+    return count;
+    #endif
+}
+
+// The precode matrix is almost entirely binary: only the HDPC rows have
+// values other than 0 and 1. So we keep binary rows bit-packed in
+// 64 bit words, and only the rows that need it as dense octets.
+// A binary row becomes dense ("promoted") only when an operation puts
+// a non-binary value in it.
+// Rows are accessed through an index, so row swaps never move data.
+class RAPTORQ_LOCAL Hybrid_Mtx
+{
+public:
+    Hybrid_Mtx() = default;
+    Hybrid_Mtx (const uint32_t rows, const uint32_t cols)
+        : _rows (rows), _cols (cols), _words ((cols + 63) / 64),
+                    _bits (static_cast<size_t> (rows) * _words, 0),
+                    _dense_slot (rows, no_slot)
+    {
+        _row_slot.reserve (rows);
+        for (uint32_t row = 0; row < rows; ++row)
+            _row_slot.push_back (row);
+    }
+    Hybrid_Mtx (const Hybrid_Mtx&) = default;
+    Hybrid_Mtx& operator= (const Hybrid_Mtx&) = default;
+    Hybrid_Mtx (Hybrid_Mtx&&) = default;
+    Hybrid_Mtx& operator= (Hybrid_Mtx&&) = default;
+    ~Hybrid_Mtx() = default;
+
+    uint32_t rows() const
+        { return _rows; }
+    uint32_t cols() const
+        { return _cols; }
+
+    // memory used by the matrix data
+    size_t bytes() const
+        { return _bits.size() * sizeof(uint64_t) + _dense.size(); }
+
+    // add "count" rows of zeros at the end
+    void add_rows (const uint32_t count)
+    {
+        _bits.resize (_bits.size() + static_cast<size_t> (count) * _words, 0);
+        _dense_slot.resize (_rows + count, no_slot);
+        for (uint32_t row = _rows; row < _rows + count; ++row)
+            _row_slot.push_back (row);
+        _rows += count;
+    }
+
+    bool is_dense (const uint32_t row) const
+        { return _dense_slot[_row_slot[row]] != no_slot; }
+
+    // store the row as octets, regardless of its content.
+    void make_dense (const uint32_t row)
+    {
+        const uint32_t slot = _row_slot[row];
+        if (_dense_slot[slot] != no_slot)
+            return;
+        _dense_slot[slot] = static_cast<uint32_t> (_dense.size() / _cols);
+        _dense.resize (_dense.size() + _cols, 0);
+        uint8_t *dense = dense_row (row);
+        uint64_t *bits = bit_row (row);
+        for (uint32_t word = 0; word < _words; ++word) {
+            uint64_t w = bits[word];
+            while (w != 0) {
+                dense[word * 64 + ctz64 (w)] = 1;
+                w &= w - 1;
+            }
+            bits[word] = 0;
+        }
+    }
+
+    Octet operator() (const uint32_t row, const uint32_t col) const
+    {
+        if (is_dense (row))
+            return Octet (dense_row (row)[col]);
+        const uint64_t word = bit_row (row)[col / 64];
+        return Octet (static_cast<uint8_t> ((word >> (col % 64)) & 1));
+    }
+
+    void set (const uint32_t row, const uint32_t col, const Octet val)
+    {
+        const uint8_t value = static_cast<uint8_t> (val);
+        if (!is_dense (row) && value > 1)
+            make_dense (row);
+        if (is_dense (row)) {
+            dense_row (row)[col] = value;
+            return;
+        }
+        const uint64_t bit = static_cast<uint64_t> (1) << (col % 64);
+        if (value == 0) {
+            bit_row (row)[col / 64] &= ~bit;
+        } else {
+            bit_row (row)[col / 64] |= bit;
+        }
+    }
+
+    // all zeros. Dense rows stay dense.
+    void clear_row (const uint32_t row)
+    {
+        if (is_dense (row)) {
+            std::fill (dense_row (row), dense_row (row) + _cols, 0);
+        } else {
+            std::fill (bit_row (row), bit_row (row) + _words, 0);
+        }
+    }
+
+    void swap_rows (const uint32_t row_1, const uint32_t row_2)
+        { std::swap (_row_slot[row_1], _row_slot[row_2]); }
+
+    // row dst += row src * scalar
+    void add_mul (const uint32_t dst, const uint32_t src, const Octet scalar)
+    {
+        const uint8_t mul = static_cast<uint8_t> (scalar);
+        if (mul == 0)
+            return;
+        if (mul == 1 && !is_dense (dst) && !is_dense (src)) {
+            uint64_t *d = bit_row (dst);
+            const uint64_t *s = bit_row (src);
+            for (uint32_t word = 0; word < _words; ++word)
+                d[word] ^= s[word];
+            return;
+        }
+        make_dense (dst);
+        uint8_t *d = dense_row (dst);
+        if (is_dense (src)) {
+            GF256::add_mul (d, dense_row (src), mul, _cols);
+            return;
+        }
+        const uint64_t *s = bit_row (src);
+        for (uint32_t word = 0; word < _words; ++word) {
+            uint64_t w = s[word];
+            while (w != 0) {
+                d[word * 64 + ctz64 (w)] ^= mul;
+                w &= w - 1;
+            }
+        }
+    }
+
+    // row /= scalar
+    void div (const uint32_t row, const Octet scalar)
+    {
+        if (static_cast<uint8_t> (scalar) == 1)
+            return;
+        make_dense (row);
+        GF256::div (dense_row (row), static_cast<uint8_t> (scalar), _cols);
+    }
+
+    // call "fn (col)" for each nonzero element of the row that is in
+    // the "cols" bitmask, in increasing column order.
+    template <typename Fn>
+    void for_each_nonzero (const uint32_t row,
+                            const std::vector<uint64_t> &cols, Fn fn) const
+    {
+        if (is_dense (row)) {
+            const uint8_t *dense = dense_row (row);
+            for (uint32_t word = 0; word < _words; ++word) {
+                uint64_t w = cols[word];
+                while (w != 0) {
+                    const uint32_t col = word * 64 + ctz64 (w);
+                    if (dense[col] != 0)
+                        fn (col);
+                    w &= w - 1;
+                }
+            }
+            return;
+        }
+        const uint64_t *bits = bit_row (row);
+        for (uint32_t word = 0; word < _words; ++word) {
+            uint64_t w = bits[word] & cols[word];
+            while (w != 0) {
+                fn (word * 64 + ctz64 (w));
+                w &= w - 1;
+            }
+        }
+    }
+
+    // reorder all the columns: column "col" becomes the old column
+    // order[col]
+    void permute_cols (const std::vector<uint16_t> &order)
+    {
+        std::vector<uint8_t> tmp (_cols);
+        std::vector<uint64_t> tmp_bits (_words);
+        std::vector<uint32_t> new_col (_cols);
+        for (uint32_t col = 0; col < _cols; ++col)
+            new_col[order[col]] = col;
+        for (uint32_t row = 0; row < _rows; ++row) {
+            if (is_dense (row)) {
+                uint8_t *dense = dense_row (row);
+                std::copy (dense, dense + _cols, tmp.begin());
+                for (uint32_t col = 0; col < _cols; ++col)
+                    dense[col] = tmp[order[col]];
+                continue;
+            }
+            uint64_t *bits = bit_row (row);
+            std::fill (tmp_bits.begin(), tmp_bits.end(), 0);
+            for (uint32_t word = 0; word < _words; ++word) {
+                uint64_t w = bits[word];
+                while (w != 0) {
+                    const uint32_t col = new_col[word * 64 + ctz64 (w)];
+                    tmp_bits[col / 64] |=
+                                    static_cast<uint64_t> (1) << (col % 64);
+                    w &= w - 1;
+                }
+            }
+            std::copy (tmp_bits.begin(), tmp_bits.end(), bits);
+        }
+    }
+
+private:
+    enum : uint32_t { no_slot = std::numeric_limits<uint32_t>::max() };
+
+    uint32_t _rows = 0, _cols = 0, _words = 0;
+    std::vector<uint64_t> _bits;        // _rows * _words
+    std::vector<uint8_t> _dense;        // dense rows, _cols each
+    std::vector<uint32_t> _row_slot;    // row -> storage slot
+    std::vector<uint32_t> _dense_slot;  // storage slot -> dense row, if any
+
+    uint64_t* bit_row (const uint32_t row)
+        { return _bits.data() + static_cast<size_t> (_row_slot[row]) * _words; }
+    const uint64_t* bit_row (const uint32_t row) const
+        { return _bits.data() + static_cast<size_t> (_row_slot[row]) * _words; }
+    uint8_t* dense_row (const uint32_t row)
+    {
+        return _dense.data() +
+                static_cast<size_t> (_dense_slot[_row_slot[row]]) * _cols;
+    }
+    const uint8_t* dense_row (const uint32_t row) const
+    {
+        return _dense.data() +
+                static_cast<size_t> (_dense_slot[_row_slot[row]]) * _cols;
+    }
+};
+
+}   // namespace Impl
+}   // namespace RaptorQ
@@ -129,25 +129,17 @@ public:
     Symbol_Wrap<T>& operator*= (const Symbol_Wrap<T> &a)
     {
         assert (_raw != nullptr && "Encoded_Symbol raw == nullptr");
-        for (size_t i = 0; i < _size * sizeof(T); ++i) {
-            if (_raw[i] == 0 || a._raw[i] == 0) {
-                _raw[i] = 0;
-            } else {
-                _raw[i] = RaptorQ__v1::Impl::oct_exp[
-                                        RaptorQ__v1::Impl::oct_log[_raw[i]] +
-                                        RaptorQ__v1::Impl::oct_exp[a._raw[i]]];
-            }
-        }
+        for (size_t i = 0; i < _size * sizeof(T); ++i)
+            _raw[i] = RaptorQ__v1::Impl::oct_mul[_raw[i]][a._raw[i]];
         return *this;
     }
     Symbol_Wrap<T>& operator/= (const Symbol_Wrap<T> &a)
     {
         assert (_raw != nullptr && "Encoded_Symbol raw == nullptr");
         for (size_t i = 0; i < _size * sizeof(T); ++i) {
-            if (_raw[i] != 0) {
-                _raw[i] = RaptorQ__v1::Impl::oct_exp[
-                                RaptorQ__v1::Impl::oct_log[_raw[i]] -
-                                RaptorQ__v1::Impl::oct_exp[a._raw[i]] + 255];
+            if (a._raw[i] != 0) {
+                _raw[i] = RaptorQ__v1::Impl::oct_mul[_raw[i]][
+                                        RaptorQ__v1::Impl::oct_inv[a._raw[i]]];
             }
         }
         return *this;
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2015-2016, Luca Fulchir<luca@fulchir.it>, All rights reserved.
+ *
+ * This file is part of "libRaptorQ".
+ *
+ * libRaptorQ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * libRaptorQ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * and a copy of the GNU Lesser General Public License
+ * along with libRaptorQ.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "RaptorQ/v1/common.hpp"
+#include "RaptorQ/v1/Parameters.hpp"
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace RaptorQ__v1 {
+namespace Impl {
+
+// The symbols each ISI depends on (see Parameters::get_idxs), for the
+// first "ISIs" ISIs, in a flat CSR layout.
+// Only depends on K', so it is built once and shared through
+// Neighbour_Table::get().
+class RAPTORQ_LOCAL Neighbour_Table
+{
+public:
+    Neighbour_Table (const Parameters &params, const uint32_t ISIs)
+        : _offsets (ISIs + 1),
+                    _idxs (static_cast<size_t> (ISIs) * Parameters::max_idxs)
+    {
+        params.get_idxs (0, ISIs, _offsets.data(), _idxs.data());
+        _idxs.resize (_offsets[ISIs]);
+        _idxs.shrink_to_fit();
+    }
+    Neighbour_Table() = delete;
+    Neighbour_Table (const Neighbour_Table&) = delete;
+    Neighbour_Table& operator= (const Neighbour_Table&) = delete;
+    Neighbour_Table (Neighbour_Table&&) = default;
+    Neighbour_Table& operator= (Neighbour_Table&&) = default;
+    ~Neighbour_Table() = default;
+
+    uint32_t ISIs() const
+        { return static_cast<uint32_t> (_offsets.size() - 1); }
+
+    size_t bytes() const
+    {
+        return _offsets.size() * sizeof(uint32_t) +
+                                            _idxs.size() * sizeof(uint16_t);
+    }
+
+    // same as Parameters::get_idxs, ISI must be < ISIs()
+    uint16_t get_idxs (const uint32_t ISI, uint16_t *out) const
+    {
+        const uint16_t *from = _idxs.data() + _offsets[ISI];
+        const uint16_t *to = _idxs.data() + _offsets[ISI + 1];
+        std::copy (from, to, out);
+        return static_cast<uint16_t> (to - from);
+    }
+
+    // The table for the K' of "params", covering the source symbols and
+    // as many repair symbols as the intermediate ones: ISIs [0, K' + L).
+    // Built on first use, kept up to a memory limit.
+    static std::shared_ptr<const Neighbour_Table> get (
+                                                    const Parameters &params);
+
+private:
+    std::vector<uint32_t> _offsets;
+    std::vector<uint16_t> _idxs;
+};
+
+class RAPTORQ_LOCAL Neighbour_Table_Cache
+{
+public:
+    static Neighbour_Table_Cache* get()
+    {
+        static Neighbour_Table_Cache cache;
+        return &cache;
+    }
+
+    std::shared_ptr<const Neighbour_Table> find (const uint16_t K_prime)
+    {
+        std::lock_guard<std::mutex> guard (_lock);
+        RQ_UNUSED (guard);
+        for (auto it = _tables.begin(); it != _tables.end(); ++it) {
+            if (it->first != K_prime)
+                continue;
+            // most recently used go first
+            _tables.splice (_tables.begin(), _tables, it);
+            return _tables.front().second;
+        }
+        return nullptr;
+    }
+
+    void add (const uint16_t K_prime,
+                        const std::shared_ptr<const Neighbour_Table> &table)
+    {
+        if (table->bytes() > max_bytes)
+            return;
+        std::lock_guard<std::mutex> guard (_lock);
+        RQ_UNUSED (guard);
+        for (const auto &cached : _tables) {
+            if (cached.first == K_prime)
+                return; // another thread was faster
+        }
+        _tables.emplace_front (K_prime, table);
+        _bytes += table->bytes();
+        while (_bytes > max_bytes) {
+            _bytes -= _tables.back().second->bytes();
+            _tables.pop_back();
+        }
+    }
+
+private:
+    enum : size_t { max_bytes = 16 * 1024 * 1024 };
+
+    std::mutex _lock;
+    size_t _bytes = 0;
+    std::list<std::pair<uint16_t,
+                        std::shared_ptr<const Neighbour_Table>>> _tables;
+};
+
+inline std::shared_ptr<const Neighbour_Table> Neighbour_Table::get (
+                                                    const Parameters &params)
+{
+    auto cache = Neighbour_Table_Cache::get();
+    auto table = cache->find (params.K_padded);
+    if (table != nullptr)
+        return table;
+    table = std::make_shared<const Neighbour_Table> (params,
+                                    static_cast<uint32_t> (params.K_padded) +
+                                                                    params.L);
+    cache->add (params.K_padded, table);
+    return table;
+}
+
+}   // namespace Impl
+}   // namespace RaptorQ
@@ -74,30 +74,19 @@ public:
     }
     Octet& operator*= (const Octet a)
     {
-        if (data != 0 && a.data != 0) {
-            data = RaptorQ__v1::Impl::oct_exp[oct_log[data - 1] +
-                                            oct_log[a.data - 1]];
-        } else {
-            data = 0;
-        }
+        data = RaptorQ__v1::Impl::oct_mul[data][a.data];
         return *this;
     }
     friend Octet operator* (Octet lhs, const Octet rhs)
     {
-        if (lhs.data != 0 && rhs.data != 0) {
-            lhs.data = RaptorQ__v1::Impl::oct_exp[oct_log[lhs.data - 1] +
-                                                        oct_log[rhs.data - 1]];
-        } else {
-            lhs.data = 0;
-        }
+        lhs.data = RaptorQ__v1::Impl::oct_mul[lhs.data][rhs.data];
         return lhs;
     }
     Octet& operator/= (const Octet a)
     {
-        if (a.data != 0 && data != 0) {
-            data = RaptorQ__v1::Impl::oct_exp[oct_log[data - 1] -
-                                                    oct_log[a.data - 1] + 255];
-        }
+        // division by zero leaves the value untouched, as before.
+        if (a.data != 0)
+            data = RaptorQ__v1::Impl::oct_mul[data][oct_inv[a.data]];
         return *this;
     }
 
@@ -109,7 +98,7 @@ public:
 
     Octet inverse() const
     {
-        return Octet (RaptorQ__v1::Impl::oct_exp[255 - oct_log[data - 1]]);
+        return Octet (RaptorQ__v1::Impl::oct_inv[data]);
     }
 
     bool operator== (const Octet a) const
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "RaptorQ/v1/common.hpp"
+#include "RaptorQ/v1/gf256.hpp"
 #include "RaptorQ/v1/Parameters.hpp"
 #include "RaptorQ/v1/Octet.hpp"
 #include <Eigen/Dense>
@@ -40,7 +41,6 @@ public:
         SWAP = 0x01,
         ADD_MUL = 0x02,
         DIV = 0x03,
-        BLOCK = 0x04,
         REORDER = 0x05
     };
     Operation() = delete;
@@ -58,9 +58,6 @@ public:
         case _t::DIV:
             div = rhs.div;
             break;
-        case _t::BLOCK:
-            block = rhs.block;
-            break;
         case _t::REORDER:
             reorder = rhs.reorder;
             break;
@@ -82,9 +79,6 @@ public:
         case _t::DIV:
             div = rhs.div;
             break;
-        case _t::BLOCK:
-            block = rhs.block;
-            break;
         case _t::REORDER:
             reorder = rhs.reorder;
             break;
@@ -108,9 +102,6 @@ public:
         case _t::DIV:
             div = std::move (rhs.div);
             break;
-        case _t::BLOCK:
-            block = std::move (rhs.block);
-            break;
         case _t::REORDER:
             reorder = std::move (rhs.reorder);
             break;
@@ -133,9 +124,6 @@ public:
         case _t::DIV:
             div = std::move (rhs.div);
             break;
-        case _t::BLOCK:
-            block = std::move (rhs.block);
-            break;
         case _t::REORDER:
             reorder = std::move (rhs.reorder);
             break;
@@ -153,33 +141,31 @@ public:
                                             { assert (type == _t::ADD_MUL); }
     Operation (const _t type, const uint16_t row, const Octet scalar)
         : _type (type), div (row, scalar) { assert (type == _t::DIV); }
-    Operation (const _t type, const DenseMtx &mtx)
-        : _type (type), block (mtx) { assert (type == _t::BLOCK); }
     Operation (const _t type, const std::vector<uint16_t> &order)
         : _type (type), reorder (order) { assert (type == _t::REORDER); }
 
     ~Operation ()
     {
-        if (_type == _t::BLOCK)
-            block.clear();
         if (_type == _t::REORDER)
             reorder.clear();
     }
 
-    void build_mtx (DenseMtx &mtx) const
+    // append the operation to a Schedule (or anything with the same
+    // add_* methods)
+    template <typename Out>
+    void compile (Out &out) const
     {
         switch (_type)
         {
         case _t::SWAP:
-            return swap.build_mtx (mtx);
+            return out.add_swap (swap._row_1, swap._row_2);
         case _t::ADD_MUL:
-            return add_mul.build_mtx (mtx);
+            return out.add_add_mul (add_mul._row_1, add_mul._row_2,
+                                                            add_mul._scalar);
         case _t::DIV:
-            return div.build_mtx (mtx);
-        case _t::BLOCK:
-            return block.build_mtx (mtx);
+            return out.add_div (div._row_1, div._scalar);
         case _t::REORDER:
-            return reorder.build_mtx (mtx);
+            return out.add_reorder (reorder._order);
         case _t::NONE:
             break;
         }
@@ -197,8 +183,7 @@ private:
         Swap (Swap &&) = default;
         Swap& operator= (Swap &&) = default;
         ~Swap() {}
-        void build_mtx (DenseMtx &mtx) const
-            { mtx.row(_row_1).swap (mtx.row(_row_2)); }
+        friend class Operation;
     private:
         uint16_t _row_1, _row_2;
     };
@@ -213,11 +198,7 @@ private:
         Add_Mul (Add_Mul&&) = default;
         Add_Mul& operator= (Add_Mul&&) = default;
         ~Add_Mul() {}
-        void build_mtx (DenseMtx &mtx) const
-        {
-            const auto row = mtx.row (_row_2) * _scalar;
-            mtx.row (_row_1) += row;
-        }
+        friend class Operation;
     private:
         uint16_t _row_1, _row_2;
         Octet _scalar;
@@ -233,34 +214,12 @@ private:
         Div (Div&&) = default;
         Div& operator= (Div&&) = default;
         ~Div() {}
-        void build_mtx (DenseMtx &mtx) const
-            { mtx.row (_row_1) /= _scalar; }
+        friend class Operation;
     private:
         uint16_t _row_1;
         Octet _scalar;
     };
 
-    class RAPTORQ_LOCAL Block
-    {
-    public:
-        Block (const DenseMtx &block)
-            : _block (block) {}
-        Block (const Block&) = default;
-        Block& operator= (const Block&) = default;
-        Block (Block&&) = default;
-        Block& operator= (Block&&) = default;
-        ~Block() {}
-        void build_mtx (DenseMtx &mtx) const
-        {
-            const auto orig = mtx.block (0,0, _block.cols(), mtx.cols());
-            mtx.block (0, 0, _block.cols(), mtx.cols()) = _block * orig;
-        }
-        void clear()
-            { _block = DenseMtx(); }
-    private:
-        DenseMtx _block;
-    };
-
     class RAPTORQ_LOCAL Reorder
     {
     public:
@@ -271,19 +230,7 @@ private:
         Reorder (Reorder&&) = default;
         Reorder& operator= (Reorder&&) = default;
         ~Reorder() {}
-        void build_mtx (DenseMtx &mtx) const
-        {
-            uint16_t overhead = static_cast<uint16_t> (
-                                static_cast<uint16_t> (mtx.rows()) - _order.size());
-            DenseMtx ret = DenseMtx (mtx.rows() - overhead , mtx.cols());
-
-            // reorder some of the lines as requested by the _order vector
-            uint16_t row = 0;
-            for (const uint16_t pos : _order)
-                ret.row (pos) = mtx.row (row++);
-            mtx.swap (ret);
-            // other lines will not influence the computation, ignore them
-        }
+        friend class Operation;
         void clear()
             { _order = std::vector<uint16_t>(); }
     private:
@@ -295,7 +242,6 @@ private:
         Swap swap;
         Add_Mul add_mul;
         Div div;
-        Block block;
         Reorder reorder;
     };
 };
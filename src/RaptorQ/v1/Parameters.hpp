@@ -24,7 +24,7 @@
 #include "RaptorQ/v1/degree.hpp"
 #include "RaptorQ/v1/Rand.hpp"
 #include "RaptorQ/v1/table2.hpp"
-#include <cmath>
+#include <algorithm>
 #include <Eigen/Core>
 #include <vector>
 
@@ -61,9 +61,20 @@ public:
     Parameters& operator= (Parameters&&) = default;
     ~Parameters() {}
 
+    // max number of indexes returned by get_idxs: LT degree + PI degree
+    enum : uint16_t { max_idxs = 30 + 3 };
+
     uint16_t Deg (const uint32_t v) const;
     Tuple tuple (const uint32_t ISI) const;
     std::vector<uint16_t> get_idxs (const uint32_t ISI) const;
+    // "out" must have room for max_idxs. returns how many we wrote.
+    uint16_t get_idxs (const uint32_t ISI, uint16_t *out) const;
+    // indexes of all ISIs in [from, to), one after the other.
+    // offsets[i] is where the indexes of ISI (from + i) begin in "idxs",
+    // offsets[to - from] is the total. "offsets" must have room for
+    // (to - from + 1) elements, "idxs" for (to - from) * max_idxs.
+    void get_idxs (const uint32_t from, const uint32_t to, uint32_t *offsets,
+                                                        uint16_t *idxs) const;
 
     uint16_t K_padded, S, H, W, L, P, P1, U, B; // RFC 6330, pg 22
     uint16_t J;
@@ -119,12 +130,14 @@ inline bool Parameters::is_prime (const uint16_t n)
 inline uint16_t Parameters::Deg (const uint32_t v) const
 {
     // rfc 6330, pg 27
-
-    for (uint16_t d = 0; d < RaptorQ__v1::Impl::degree_distribution.size();++d){
-        if (v < RaptorQ__v1::Impl::degree_distribution[d])
-            return (d < (W - 2)) ? d : (W - 2);
-    }
-    return 0;   // never get here, but don't make the compiler complain
+    // first d such that v < degree_distribution[d]
+    // v < 2^20, so we always find one.
+    const auto it = std::upper_bound (
+                                RaptorQ__v1::Impl::degree_distribution.begin(),
+                                RaptorQ__v1::Impl::degree_distribution.end(), v);
+    const uint16_t d = static_cast<uint16_t> (
+                        it - RaptorQ__v1::Impl::degree_distribution.begin());
+    return (d < (W - 2)) ? d : (W - 2);
 }
 
 inline Tuple RaptorQ__v1::Impl::Parameters::tuple (const uint32_t ISI) const
@@ -142,7 +155,7 @@ inline Tuple RaptorQ__v1::Impl::Parameters::tuple (const uint32_t ISI) const
         ++A;
     size_t B1 = 10267 * (J + 1);
     uint32_t y = static_cast<uint32_t> (B1 + ISI * A);
-    uint32_t v = rnd_get (y, 0, static_cast<uint32_t> (std::pow(2, 20)));
+    uint32_t v = rnd_get (y, 0, static_cast<uint32_t> (1) << 20);
     ret.d = Deg (v);
     ret.a = 1 + static_cast<uint16_t> (rnd_get (y, 1, W - 1));
     ret.b = static_cast<uint16_t> (rnd_get (y, 2, W));
@@ -158,33 +171,58 @@ inline Tuple RaptorQ__v1::Impl::Parameters::tuple (const uint32_t ISI) const
 }
 
 inline std::vector<uint16_t> Parameters::get_idxs (const uint32_t ISI) const
+{
+    std::vector<uint16_t> ret (max_idxs);
+    ret.resize (get_idxs (ISI, ret.data()));
+    return ret;
+}
+
+inline uint16_t Parameters::get_idxs (const uint32_t ISI, uint16_t *out) const
 {
     // Needed to generate G_ENC: We need the ids of the symbols we would
     // use on a "Enc" call. So this is the "enc algorithm, but returns the
     // indexes instead of computing the result.
     // rfc6330, pg29
 
-    std::vector<uint16_t> ret;
+    uint16_t written = 0;
     Tuple t = tuple (ISI);
+    // a < W and b < W, so (b + a) % W is just a subtraction.
+    // Same for a1, b1 and P1. The sums might not fit in 16 bits.
+    const auto next = [] (const uint16_t b, const uint16_t a,
+                                                        const uint16_t mod) {
+        const uint32_t sum = static_cast<uint32_t> (b) + a;
+        return static_cast<uint16_t> (sum >= mod ? sum - mod : sum);
+    };
 
-    ret.reserve (t.d + t.d1);
-    ret.push_back (t.b);
+    out[written++] = t.b;
 
     for (uint16_t j = 1; j < t.d; ++j) {
-        t.b = (t.b + t.a) % W;
-        ret.push_back (t.b);
+        t.b = next (t.b, t.a, W);
+        out[written++] = t.b;
     }
     while (t.b1 >= P)
-        t.b1 = (t.b1 + t.a1) % P1;
+        t.b1 = next (t.b1, t.a1, P1);
 
-    ret.push_back (W + t.b1);
+    out[written++] = W + t.b1;
     for (uint16_t j = 1; j < t.d1; ++j) {
-        t.b1 = (t.b1 + t.a1) % P1;
+        t.b1 = next (t.b1, t.a1, P1);
         while (t.b1 >= P)
-            t.b1 = (t.b1 + t.a1) % P1;
-        ret.push_back (W + t.b1);
+            t.b1 = next (t.b1, t.a1, P1);
+        out[written++] = W + t.b1;
     }
-    return ret;
+    return written;
+}
+
+inline void Parameters::get_idxs (const uint32_t from, const uint32_t to,
+                                                        uint32_t *offsets,
+                                                        uint16_t *idxs) const
+{
+    uint32_t written = 0;
+    for (uint32_t ISI = from; ISI < to; ++ISI) {
+        offsets[ISI - from] = written;
+        written += get_idxs (ISI, idxs + written);
+    }
+    offsets[to - from] = written;
 }
 
 }   // namespace Impl
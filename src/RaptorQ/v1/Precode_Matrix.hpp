@@ -22,10 +22,15 @@
 
 #include "RaptorQ/v1/util/Bitmask.hpp"
 #include "RaptorQ/v1/common.hpp"
+#include "RaptorQ/v1/gf256.hpp"
+#include "RaptorQ/v1/Hybrid_Mtx.hpp"
 #include "RaptorQ/v1/multiplication.hpp"
+#include "RaptorQ/v1/Neighbour_Table.hpp"
 #include "RaptorQ/v1/Operation.hpp"
 #include "RaptorQ/v1/Octet.hpp"
 #include "RaptorQ/v1/Parameters.hpp"
+#include "RaptorQ/v1/Schedule.hpp"
+#include "RaptorQ/v1/Symbol_Mtx.hpp"
 #include "RaptorQ/v1/Thread_Pool.hpp"
 #include <Eigen/Dense>
 #include <deque>
@@ -55,11 +60,11 @@ public:
     const Parameters _params;
 
     Precode_Matrix(const Parameters &params)
-        :_params (params)
+        :_params (params), _neighbours (Neighbour_Table::get (params))
     {}
     Precode_Matrix() = delete;
-    Precode_Matrix (const Precode_Matrix&) = default;
-    Precode_Matrix& operator= (const Precode_Matrix&) = default;
+    Precode_Matrix (const Precode_Matrix&) = delete;
+    Precode_Matrix& operator= (const Precode_Matrix&) = delete;
     Precode_Matrix (Precode_Matrix&&) = default;
     Precode_Matrix& operator= (Precode_Matrix&&) = default;
     ~Precode_Matrix() = default;
@@ -76,42 +81,98 @@ public:
                                         Op_Vec &ops, bool &keep_working,
                                         const Work_State *thread_keep_working);
     DenseMtx get_missing (const DenseMtx &C, const Bitmask &mask) const;
-    DenseMtx encode (const DenseMtx &C, const uint32_t ISI) const;
+    // write the symbol "ISI" (C.cols() bytes) in "out"
+    void encode (const DenseMtx &C, const uint32_t ISI, uint8_t *out) const;
+    // write the symbols [ISI, ISI + count) in "out", "stride" bytes apart
+    void encode (const DenseMtx &C, const uint32_t ISI, const uint32_t count,
+                                    uint8_t *out, const size_t stride) const;
+
+    // online decoding: each row is eliminated as soon as its symbol
+    // arrives, so that in the end only the back-substitution is left.
+    // "symbols" is the number of source symbols, ISIs must already
+    // account for the padding.
+    void online_init (const uint16_t symbols, const size_t symbol_size);
+    void online_add (const uint32_t ISI, const uint8_t *symbol);
+    // the missing source symbols, same as get_missing()
+    std::pair<Precode_Result, DenseMtx> online_solve (const Bitmask &mask)
+                                                                        const;
 
 private:
-    DenseMtx A;
+    // encode() of many symbols works on "encode_batch" symbols at a time,
+    // and on tiles of columns of about l2_bytes for all the rows of C.
+    enum : uint32_t { encode_batch = 32 };
+    enum : size_t { l2_bytes = 1024 * 1024,
+                    min_tile = 4096 };
+
+    Hybrid_Mtx A;
     uint32_t _repair_overhead = 0;
+    std::shared_ptr<const Neighbour_Table> _neighbours;
+    bool _sliced = false;   // recording the operations for a sliced D
+
+    // online decoding. The binary rows are indexed by their pivot column,
+    // row L is the one being eliminated. The HDPC rows are only used
+    // at the end, as they are dense.
+    uint32_t _online_words = 0;
+    std::vector<uint64_t> _online_bits;     // by storage slot
+    std::vector<uint32_t> _online_slot;     // row -> storage slot
+    std::vector<uint32_t> _online_weight;   // nonzeros, by storage slot
+    std::vector<bool> _online_pivot;        // column -> has a pivot row
+    std::vector<uint8_t> _online_hdpc;      // H x L
+    Symbol_Mtx _online_sym;                 // same rows as _online_slot
+
+    // operations are recorded for the cache, or for the sliced solver
+    bool record_ops() const
+        { return IS_OFFLINE == Save_Computation::ON || _sliced; }
+
+    // Parameters::get_idxs, through the shared table when possible
+    uint16_t get_idxs (const uint32_t ISI, uint16_t *out) const
+    {
+        if (ISI < _neighbours->ISIs())
+            return _neighbours->get_idxs (ISI, out);
+        return _params.get_idxs (ISI, out);
+    }
+
+    uint64_t* online_row (const uint32_t row)
+    {
+        return _online_bits.data() +
+                        static_cast<size_t> (_online_slot[row]) * _online_words;
+    }
+    const uint64_t* online_row (const uint32_t row) const
+    {
+        return _online_bits.data() +
+                        static_cast<size_t> (_online_slot[row]) * _online_words;
+    }
+    void online_eliminate();
 
     // indenting here prepresent which function needs which other.
     // not standard, ask me if I care.
-    void init_LDPC1 (DenseMtx &_A, const uint16_t S, const uint16_t B) const;
-    void init_LDPC2 (DenseMtx &_A, const uint16_t skip, const uint16_t rows,
+    void init_LDPC1 (Hybrid_Mtx &_A, const uint16_t S, const uint16_t B) const;
+    void init_LDPC2 (Hybrid_Mtx &_A, const uint16_t skip, const uint16_t rows,
                                                     const uint16_t cols) const;
-    void add_identity (DenseMtx &_A, const uint16_t size,
+    void add_identity (Hybrid_Mtx &_A, const uint16_t size,
                                                 const uint16_t skip_row,
                                                 const uint16_t skip_col) const;
 
-    void init_HDPC (DenseMtx &_A) const;
-        DenseMtx make_MT() const;       // rfc 6330, pgg 24, used for HDPC
-        DenseMtx make_GAMMA() const;    // rfc 6330, pgg 24, used for HDPC
-    void add_G_ENC (DenseMtx &_A) const;
+    void init_HDPC (Hybrid_Mtx &_A) const;
+    void add_G_ENC (Hybrid_Mtx &_A) const;
 
     //DenseMtx intermediate (DenseMtx &D, Op_Vec &ops, bool &keep_working);
+    std::pair<Precode_Result, DenseMtx> intermediate_sliced (DenseMtx &D,
+                                        Op_Vec &ops, bool &keep_working,
+                                        const Work_State *thread_keep_working);
     void decode_phase0 (const Bitmask &mask,
                                     const std::vector<uint32_t> &repair_esi);
-    std::tuple<bool, uint16_t, uint16_t> decode_phase1 (DenseMtx &X,DenseMtx &D,
+    std::tuple<bool, uint16_t, uint16_t> decode_phase1 (Symbol_Mtx &D,
                                         std::vector<uint16_t> &c,
                                         Op_Vec &ops, bool &keep_working,
                                         const Work_State *thread_keep_working);
-    bool decode_phase2 (DenseMtx &D, const uint16_t i,const uint16_t u,
+    bool decode_phase2 (Symbol_Mtx &D, const uint16_t i,const uint16_t u,
                                         Op_Vec &ops, bool &keep_working,
                                         const Work_State *thread_keep_working);
-    void decode_phase3 (const DenseMtx &X, DenseMtx &D, const uint16_t i,
-                                        Op_Vec &ops);
-    void decode_phase4 (DenseMtx &D, const uint16_t i, const uint16_t u,
+    void decode_phase4 (Symbol_Mtx &D, const uint16_t i, const uint16_t u,
                                         Op_Vec &ops, bool &keep_working,
                                         const Work_State *thread_keep_working);
-    void decode_phase5 (DenseMtx &D, const uint16_t i, Op_Vec &ops,
+    void decode_phase5 (Symbol_Mtx &D, const uint16_t i, Op_Vec &ops,
                                         bool &keep_working,
                                         const Work_State *thread_keep_working);
 
@@ -127,3 +188,4 @@ private:
 
 #include "Precode_Matrix_Init.hpp" // above template implementation
 #include "Precode_Matrix_Solver.hpp" // above template implementation
+#include "Precode_Matrix_Online.hpp" // above template implementation
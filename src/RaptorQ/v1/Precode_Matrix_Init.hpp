@@ -23,6 +23,11 @@
 #include "RaptorQ/v1/Precode_Matrix.hpp"
 #include "RaptorQ/v1/Rand.hpp"
 #include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 ///////////////////
 //
@@ -37,29 +42,84 @@ namespace Impl {
 /// These methods are used to generate the precode matrix.
 ///
 
+// The constraint matrix without the overhead rows only depends on K',
+// so it is shared by all encoders and decoders: keep the ones we built
+// last, up to a memory limit.
+class RAPTORQ_LOCAL Base_Precode_Cache
+{
+public:
+    static Base_Precode_Cache* get()
+    {
+        static Base_Precode_Cache cache;
+        return &cache;
+    }
+
+    std::shared_ptr<const Hybrid_Mtx> find (const uint16_t K_prime)
+    {
+        std::lock_guard<std::mutex> guard (_lock);
+        RQ_UNUSED (guard);
+        for (auto it = _mtx.begin(); it != _mtx.end(); ++it) {
+            if (it->first != K_prime)
+                continue;
+            // most recently used go first
+            _mtx.splice (_mtx.begin(), _mtx, it);
+            return _mtx.front().second;
+        }
+        return nullptr;
+    }
+
+    void add (const uint16_t K_prime,
+                                    const std::shared_ptr<const Hybrid_Mtx> &A)
+    {
+        if (A->bytes() > max_bytes)
+            return;
+        std::lock_guard<std::mutex> guard (_lock);
+        RQ_UNUSED (guard);
+        for (const auto &cached : _mtx) {
+            if (cached.first == K_prime)
+                return; // another thread was faster
+        }
+        _mtx.emplace_front (K_prime, A);
+        _bytes += A->bytes();
+        while (_bytes > max_bytes) {
+            _bytes -= _mtx.back().second->bytes();
+            _mtx.pop_back();
+        }
+    }
+
+private:
+    enum : size_t { max_bytes = 64 * 1024 * 1024 };
+
+    std::mutex _lock;
+    std::list<std::pair<uint16_t, std::shared_ptr<const Hybrid_Mtx>>> _mtx;
+    size_t _bytes = 0;
+};
+
 template<Save_Computation IS_OFFLINE>
 void Precode_Matrix<IS_OFFLINE>::gen (const uint32_t repair_overhead)
 {
     _repair_overhead = repair_overhead;
-    DenseMtx _A = DenseMtx (_params.L + repair_overhead, _params.L);
-
-    init_LDPC1 (_A, _params.S, _params.B);
-    add_identity (_A, _params.S, 0, _params.B);
-    init_LDPC2 (_A, _params.W, _params.S, _params.P);
-    init_HDPC (_A);
-    add_identity (_A, _params.H, _params.S, _params.L - _params.H);
-    add_G_ENC (_A);
-    // G_ENC only fills up to L rows, but we might have overhead.
-    // initialize it.
-    for (uint16_t row = _params.L; row < A.rows(); ++row) {
-        for (uint16_t col = 0; col < A.cols(); ++col)
-            _A (row, col) = 0;
+    auto base = Base_Precode_Cache::get()->find (_params.K_padded);
+    if (base == nullptr) {
+        // everything starts as zero: the G_ENC rows only go up to L
+        Hybrid_Mtx _A = Hybrid_Mtx (_params.L, _params.L);
+
+        init_LDPC1 (_A, _params.S, _params.B);
+        add_identity (_A, _params.S, 0, _params.B);
+        init_LDPC2 (_A, _params.W, _params.S, _params.P);
+        init_HDPC (_A);
+        add_identity (_A, _params.H, _params.S, _params.L - _params.H);
+        add_G_ENC (_A);
+        base = std::make_shared<const Hybrid_Mtx> (std::move (_A));
+        Base_Precode_Cache::get()->add (_params.K_padded, base);
     }
-    A = std::move (_A);
+    A = *base;
+    // the overhead rows will be filled later.
+    A.add_rows (repair_overhead);
 }
 
 template<Save_Computation IS_OFFLINE>
-void Precode_Matrix<IS_OFFLINE>::init_LDPC1 (DenseMtx &_A, const uint16_t S,
+void Precode_Matrix<IS_OFFLINE>::init_LDPC1 (Hybrid_Mtx &_A, const uint16_t S,
                                                         const uint16_t B) const
 {
     // The first LDPC1 submatrix is a SxB matrix of SxS submatrixes
@@ -83,26 +143,25 @@ void Precode_Matrix<IS_OFFLINE>::init_LDPC1 (DenseMtx &_A, const uint16_t S,
                     (row == (col + 2 * (submtx + 1)) % S)) {// 2* (i+1) & dshift
                 zero = false ;
             }
-            _A (row, col) = (zero ? 0 : 1);
+            _A.set (row, col, (zero ? 0 : 1));
         }
     }
 }
 
 template<Save_Computation IS_OFFLINE>
-void Precode_Matrix<IS_OFFLINE>::add_identity (DenseMtx &_A,
+void Precode_Matrix<IS_OFFLINE>::add_identity (Hybrid_Mtx &_A,
                                                 const uint16_t size,
                                                 const uint16_t skip_row,
                                                 const uint16_t skip_col) const
 {
-    auto sub_mtx = _A.block (skip_row, skip_col, size, size);
-    for (uint16_t row = 0; row < sub_mtx.rows(); ++row) {
-        for (uint16_t col = 0; col < sub_mtx.cols(); ++col)
-            sub_mtx (row, col) = (row == col ? 1 : 0);
+    for (uint16_t row = 0; row < size; ++row) {
+        for (uint16_t col = 0; col < size; ++col)
+            _A.set (skip_row + row, skip_col + col, (row == col ? 1 : 0));
     }
 }
 
 template<Save_Computation IS_OFFLINE>
-void Precode_Matrix<IS_OFFLINE>::init_LDPC2 (DenseMtx &_A, const uint16_t skip,
+void Precode_Matrix<IS_OFFLINE>::init_LDPC2 (Hybrid_Mtx &_A, const uint16_t skip,
                                                     const uint16_t rows,
                                                     const uint16_t cols) const
 {
@@ -112,92 +171,61 @@ void Precode_Matrix<IS_OFFLINE>::init_LDPC2 (DenseMtx &_A, const uint16_t skip,
     // You won't find this easily on the rfc, but you can see this in the book:
     //  Raptor Codes Foundations and Trends in Communications
     //  and Information Theory
-    auto sub_mtx = _A.block (0, skip, rows, cols);
-    for (uint16_t row = 0; row < sub_mtx.rows(); ++row) {
+    for (uint16_t row = 0; row < rows; ++row) {
         uint16_t start = row % cols;
-        for (uint16_t col = 0; col < sub_mtx.cols(); ++col) {
+        for (uint16_t col = 0; col < cols; ++col) {
             if (col == start || col == (start + 1) % cols) {
-                sub_mtx (row, col) = 1;
+                _A.set (row, skip + col, 1);
             } else {
-                sub_mtx (row, col) = 0;
+                _A.set (row, skip + col, 0);
             }
         }
     }
 }
 
 template<Save_Computation IS_OFFLINE>
-DenseMtx Precode_Matrix<IS_OFFLINE>::make_MT() const
+void Precode_Matrix<IS_OFFLINE>::init_HDPC (Hybrid_Mtx &_A) const
 {
-    // rfc 6330, pg 24
-
-    DenseMtx MT = DenseMtx (_params.H, _params.K_padded + _params.S);
-
-    for (uint16_t row = 0; row < MT.rows(); ++row) {
-        uint16_t col;
-        for (col = 0; col < MT.cols() - 1; ++col) {
-            auto tmp = rnd_get (col + 1, 6, _params.H);
-            if ((row == tmp) || (row ==
-                                (tmp + rnd_get (col + 1, 7, _params.H - 1) + 1)
-                                                                % _params.H)) {
-                MT (row, col) = 1;
-            } else {
-                MT (row, col) = 0;
-            }
-        }
-        // last column: alpha ^^ i, as in rfc6330
-        MT (row, col) = RaptorQ__v1::Impl::oct_exp[row];
+    // rfc 6330, pg 25
+    // HDPC = MT * GAMMA, with GAMMA (row, col) = alpha^^(row - col) for
+    // col <= row, and 0 otherwise. So, from the last column:
+    //      HDPC (h, col) = MT (h, col) + alpha * HDPC (h, col + 1)
+    // and each column of MT has only two ones, except for the last one,
+    // which is alpha^^h. No need to build MT or GAMMA.
+    // alpha^^i == oct_exp(i), end of Section 5.7.2
+    const uint16_t cols = _params.K_padded + _params.S;
+    std::vector<uint8_t> hdpc_col (_params.H);
+    for (uint16_t row = 0; row < _params.H; ++row) {
+        // HDPC rows are the only non-binary ones.
+        _A.make_dense (_params.S + row);
+        hdpc_col[row] = RaptorQ__v1::Impl::oct_exp[row];
+        _A.set (_params.S + row, cols - 1, Octet (hdpc_col[row]));
     }
-    return MT;
-}
-
-template<Save_Computation IS_OFFLINE>
-DenseMtx Precode_Matrix<IS_OFFLINE>::make_GAMMA() const
-{
-    // rfc 6330, pg 24
-    DenseMtx GAMMA = DenseMtx (_params.K_padded + _params.S,
-                                                _params.K_padded + _params.S);
-
-    for (uint16_t row = 0; row < GAMMA.rows(); ++row) {
-        uint16_t col;
-        for (col = 0; col <= row; ++col)
-            // alpha ^^ (i-j), as in rfc6330, pg24
-            // end of Section 5.7.2: alpha^^i == oct_exp(i)
-            //
-            // rfc only says "i-j", while the ^^ op. is defined only if
-            // the exponent is < 255.
-            // we could actually use oct_exp.size() (=>510) since oct_exp
-            // actually contains the same values twice. We still use 255
-            // so that our implementation is more similar to the other.
-            GAMMA (row, col) = RaptorQ__v1::Impl::oct_exp[(row - col) % 255];
-        for (; col < GAMMA.cols(); ++col) {
-            GAMMA (row, col) = 0;
-        }
+    for (uint16_t col = cols - 1; col > 0;) {
+        --col;
+        for (auto &val : hdpc_col)
+            val = oct_mul[val][2];  // alpha == 2
+        const uint32_t first = rnd_get (col + 1, 6, _params.H);
+        const uint32_t second = (first + rnd_get (col + 1, 7, _params.H - 1)
+                                                            + 1) % _params.H;
+        hdpc_col[first] ^= 1;
+        hdpc_col[second] ^= 1;
+        for (uint16_t row = 0; row < _params.H; ++row)
+            _A.set (_params.S + row, col, Octet (hdpc_col[row]));
     }
-    return GAMMA;
-}
-
-template<Save_Computation IS_OFFLINE>
-void Precode_Matrix<IS_OFFLINE>::init_HDPC (DenseMtx &_A) const
-{
-    // rfc 6330, pg 25
-    DenseMtx MT = make_MT();
-    DenseMtx GAMMA = make_GAMMA();
-
-    _A.block(_params.S, 0, _params.H, GAMMA.rows()) = MT * GAMMA;
 }
 
 template<Save_Computation IS_OFFLINE>
-void Precode_Matrix<IS_OFFLINE>::add_G_ENC (DenseMtx &_A) const
+void Precode_Matrix<IS_OFFLINE>::add_G_ENC (Hybrid_Mtx &_A) const
 {
     // rfc 6330, pg 26
+    uint16_t idxs[Parameters::max_idxs];
     for (uint16_t row = _params.S + _params.H; row < _params.L; ++row) {
-        // all to zero
-        for (uint16_t col = 0; col < _params.L; ++col)
-            _A (row, col) = 0;
-        // only overwrite with ones the columns that need it
-        auto idxs = _params.get_idxs ((row - _params.S) - _params.H);
-        for (auto idx : idxs)
-            _A (row, idx) = 1;
+        // all to zero, only set to one the columns that need it
+        _A.clear_row (row);
+        const uint16_t n = get_idxs ((row - _params.S) - _params.H, idxs);
+        for (uint16_t idx = 0; idx < n; ++idx)
+            _A.set (row, idxs[idx], 1);
     }
 }
 
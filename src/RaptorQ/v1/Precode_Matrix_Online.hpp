@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2015-2017, Luca Fulchir<luca@fulchir.it>, All rights reserved.
+ *
+ * This file is part of "libRaptorQ".
+ *
+ * libRaptorQ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * libRaptorQ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * and a copy of the GNU Lesser General Public License
+ * along with libRaptorQ.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "RaptorQ/v1/Precode_Matrix.hpp"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+///////////////////
+//
+// Precode_Matrix, online decoding
+//
+///////////////////
+
+// On-the-fly Gaussian elimination: every row is reduced against the
+// pivot rows as soon as its symbol arrives, and becomes a pivot row
+// itself if anything is left. Pivot rows are never reduced again,
+// so the matrix is kept upper triangular, and when enough rows are in
+// only the back-substitution is left.
+// All the binary rows are eliminated this way. The few HDPC rows are
+// dense, so they are only used at the end, to solve the columns without
+// a pivot (at most H of them).
+
+namespace RaptorQ__v1 {
+namespace Impl {
+
+template<Save_Computation IS_OFFLINE>
+void Precode_Matrix<IS_OFFLINE>::online_init (const uint16_t symbols,
+                                                    const size_t symbol_size)
+{
+    const uint16_t L = _params.L;
+    gen (0);
+
+    _online_words = (static_cast<uint32_t> (L) + 63) / 64;
+    _online_bits.assign ((static_cast<size_t> (L) + 1) * _online_words, 0);
+    _online_slot.resize (static_cast<size_t> (L) + 1);
+    for (uint32_t row = 0; row <= L; ++row)
+        _online_slot[row] = row;
+    _online_weight.assign (static_cast<size_t> (L) + 1, 0);
+    _online_pivot.assign (L, false);
+    _online_sym = Symbol_Mtx (static_cast<uint32_t> (L) + 1,
+                                        static_cast<uint32_t> (symbol_size));
+
+    _online_hdpc.resize (static_cast<size_t> (_params.H) * L);
+    for (uint16_t h = 0; h < _params.H; ++h) {
+        for (uint16_t col = 0; col < L; ++col) {
+            _online_hdpc[static_cast<size_t> (h) * L + col] =
+                            static_cast<uint8_t> (A (_params.S + h, col));
+        }
+    }
+    // the LDPC rows and the padding symbols are always there,
+    // and their symbols are all zero.
+    for (uint16_t row = 0; row < _params.S; ++row) {
+        uint64_t *bits = online_row (L);
+        std::fill (bits, bits + _online_words, 0);
+        uint32_t weight = 0;
+        for (uint16_t col = 0; col < L; ++col) {
+            if (static_cast<uint8_t> (A (row, col)) == 0)
+                continue;
+            bits[col / 64] |= static_cast<uint64_t> (1) << (col % 64);
+            ++weight;
+        }
+        _online_weight[_online_slot[L]] = weight;
+        std::fill (_online_sym.row (L), _online_sym.row (L) +
+                                                    _online_sym.stride(), 0);
+        online_eliminate();
+    }
+    for (uint32_t ISI = symbols; ISI < _params.K_padded; ++ISI)
+        online_add (ISI, nullptr);
+    A = Hybrid_Mtx();   // everything we need is in the online rows
+}
+
+template<Save_Computation IS_OFFLINE>
+void Precode_Matrix<IS_OFFLINE>::online_add (const uint32_t ISI,
+                                                        const uint8_t *symbol)
+{
+    const uint16_t L = _params.L;
+    uint16_t idxs[Parameters::max_idxs];
+    const uint16_t n = get_idxs (ISI, idxs);
+    uint64_t *bits = online_row (L);
+    std::fill (bits, bits + _online_words, 0);
+    for (uint16_t idx = 0; idx < n; ++idx)
+        bits[idxs[idx] / 64] |= static_cast<uint64_t> (1) << (idxs[idx] % 64);
+    _online_weight[_online_slot[L]] = n;
+    uint8_t *sym = _online_sym.row (L);
+    std::fill (sym, sym + _online_sym.stride(), 0);
+    if (symbol != nullptr)
+        std::memcpy (sym, symbol, _online_sym.cols());
+    online_eliminate();
+}
+
+template<Save_Computation IS_OFFLINE>
+void Precode_Matrix<IS_OFFLINE>::online_eliminate()
+{
+    // reduce row L until its first nonzero is in a column without a pivot.
+    const uint16_t L = _params.L;
+    uint32_t word = 0;
+    while (true) {
+        const uint64_t *bits = online_row (L);
+        while (word < _online_words && bits[word] == 0)
+            ++word;
+        if (word == _online_words)
+            return; // linearly dependent, nothing new here
+        const uint32_t lead = word * 64 + ctz64 (bits[word]);
+        if (!_online_pivot[lead]) {
+            std::swap (_online_slot[lead], _online_slot[L]);
+            _online_sym.swap_rows (lead, L);
+            _online_pivot[lead] = true;
+            return;
+        }
+        // keep the lighter row as the pivot: the next rows will get
+        // less fill-in, and the back-substitution will have less work.
+        if (_online_weight[_online_slot[L]] <
+                                        _online_weight[_online_slot[lead]]) {
+            std::swap (_online_slot[lead], _online_slot[L]);
+            _online_sym.swap_rows (lead, L);
+        }
+        uint64_t *dst = online_row (L);
+        const uint64_t *src = online_row (lead);
+        uint32_t weight = 0;
+        for (uint32_t w = word; w < _online_words; ++w) {
+            dst[w] ^= src[w];
+            weight += popcount64 (dst[w]);
+        }
+        _online_weight[_online_slot[L]] = weight;
+        _online_sym.add_mul (L, lead, Octet (1));
+    }
+}
+
+template<Save_Computation IS_OFFLINE>
+std::pair<Precode_Result, DenseMtx> Precode_Matrix<IS_OFFLINE>::online_solve (
+                                                    const Bitmask &mask) const
+{
+    const uint16_t L = _params.L;
+    const uint16_t H = _params.H;
+    // the columns without a pivot are the unknowns of the HDPC rows.
+    std::vector<uint16_t> free_cols;
+    for (uint16_t col = 0; col < L; ++col) {
+        if (!_online_pivot[col])
+            free_cols.push_back (col);
+    }
+    const uint16_t unknowns = static_cast<uint16_t> (free_cols.size());
+    if (unknowns > H)
+        return {Precode_Result::FAILED, DenseMtx()};
+
+    // back-substitution, on a copy so that on failure we can keep
+    // adding rows. Each intermediate symbol is:
+    //      C (col) + sum (z_k for each bit k of dep[col])
+    // with z_k the value of the column free_cols[k] (H <= 16 bits).
+    // Rows L and up are for the HDPC rows, and then for the z_k.
+    const uint32_t cols = _online_sym.cols();
+    Symbol_Mtx C (static_cast<uint32_t> (L) + H + 1, cols);
+    std::vector<uint32_t> dep (L, 0);
+    for (uint16_t k = 0; k < unknowns; ++k)
+        dep[free_cols[k]] = static_cast<uint32_t> (1) << k;
+    for (uint16_t col = L; col > 0;) {
+        --col;
+        if (!_online_pivot[col])
+            continue;
+        std::memcpy (C.row (col), _online_sym.row (col), C.stride());
+        const uint64_t *bits = online_row (col);
+        uint32_t col_dep = 0;
+        for (uint32_t word = col / 64; word < _online_words; ++word) {
+            uint64_t w = bits[word];
+            if (word == col / 64)
+                w &= ~(static_cast<uint64_t> (1) << (col % 64));
+            while (w != 0) {
+                const uint32_t other = word * 64 + ctz64 (w);
+                w &= w - 1;
+                col_dep ^= dep[other];
+                if (_online_pivot[other])
+                    C.add_mul (col, other, Octet (1));
+            }
+        }
+        dep[col] = col_dep;
+    }
+
+    // HDPC rows: sum (hdpc (h, col) * intermediate (col)) == 0, so
+    //      sum (coef (h, k) * z_k) == sum (hdpc (h, col) * C (col))
+    DenseMtx coef = DenseMtx (H, unknowns);
+    coef.setZero();
+    for (uint16_t h = 0; h < H; ++h) {
+        const uint8_t *hdpc = _online_hdpc.data() + static_cast<size_t> (h) * L;
+        for (uint16_t col = 0; col < L; ++col) {
+            if (hdpc[col] == 0)
+                continue;
+            for (uint32_t d = dep[col]; d != 0; d &= d - 1)
+                coef (h, ctz64 (d)) += Octet (hdpc[col]);
+        }
+    }
+    // HDPC = MT * GAMMA (see init_HDPC), so we can skip the H x L symbol
+    // operations: with Y (col) = alpha * Y (col - 1) + C (col)
+    //      sum (hdpc (h, col) * C (col)) == sum (MT (h, col) * Y (col))
+    // and MT (h, col) = hdpc (h, col) + alpha * hdpc (h, col + 1).
+    // After that, the HDPC rows have the identity.
+    const uint16_t gamma_cols = L - H;
+    const uint32_t Y = static_cast<uint32_t> (L) + H;
+    for (uint16_t col = 0; col < gamma_cols; ++col) {
+        GF256::mul (C.row (Y), 2, C.stride());  // alpha == 2
+        if (_online_pivot[col])
+            C.add_mul (Y, col, Octet (1));
+        for (uint16_t h = 0; h < H; ++h) {
+            const uint8_t *hdpc = _online_hdpc.data() +
+                                                static_cast<size_t> (h) * L;
+            Octet mt = Octet (hdpc[col]);
+            if (col + 1 < gamma_cols)
+                mt += Octet (2) * Octet (hdpc[col + 1]);
+            if (mt != 0)
+                C.add_mul (static_cast<uint32_t> (L) + h, Y, mt);
+        }
+    }
+    for (uint16_t h = 0; h < H; ++h) {
+        if (_online_pivot[gamma_cols + h]) {
+            C.add_mul (static_cast<uint32_t> (L) + h, gamma_cols + h,
+                                                                    Octet (1));
+        }
+    }
+    // solve for the z_k: row L + k becomes z_k
+    for (uint16_t k = 0; k < unknowns; ++k) {
+        uint16_t row = k;
+        while (row < H && coef (row, k) == 0)
+            ++row;
+        if (row == H)
+            return {Precode_Result::FAILED, DenseMtx()};
+        if (row != k) {
+            coef.row (row).swap (coef.row (k));
+            C.swap_rows (static_cast<uint32_t> (L) + row,
+                                            static_cast<uint32_t> (L) + k);
+        }
+        const Octet pivot = coef (k, k);
+        if (pivot != 1) {
+            row_div (coef, k, pivot);
+            C.div (static_cast<uint32_t> (L) + k, pivot);
+        }
+        for (row = 0; row < H; ++row) {
+            const Octet multiple = coef (row, k);
+            if (row == k || multiple == 0)
+                continue;
+            row_add_mul (coef, row, k, multiple);
+            C.add_mul (static_cast<uint32_t> (L) + row,
+                                    static_cast<uint32_t> (L) + k, multiple);
+        }
+    }
+
+    // only the missing source symbols, same as get_missing
+    DenseMtx missing = DenseMtx (mask.get_holes(), cols);
+    uint16_t idxs[Parameters::max_idxs];
+    uint16_t row = 0;
+    for (uint16_t hole = 0; hole < mask._max_nonrepair &&
+                                                row < missing.rows(); ++hole) {
+        if (mask.exists (hole))
+            continue;
+        uint8_t *out = row_data (missing, row);
+        std::fill (out, out + cols, 0);
+        const uint16_t n = get_idxs (hole, idxs);
+        uint32_t sym_dep = 0;
+        for (uint16_t idx = 0; idx < n; ++idx) {
+            sym_dep ^= dep[idxs[idx]];
+            if (_online_pivot[idxs[idx]])
+                GF256::add (out, C.row (idxs[idx]), cols);
+        }
+        for (; sym_dep != 0; sym_dep &= sym_dep - 1)
+            GF256::add (out, C.row (L + ctz64 (sym_dep)), cols);
+        ++row;
+    }
+    return {Precode_Result::DONE, std::move (missing)};
+}
+
+}   // namespace Impl
+}   // namespace RaptorQ
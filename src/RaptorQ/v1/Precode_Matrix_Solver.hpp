@@ -22,6 +22,9 @@
 
 #include "RaptorQ/v1/Precode_Matrix.hpp"
 #include "RaptorQ/v1/util/Graph.hpp"
+#include <algorithm>
+#include <functional>
+#include <tuple>
 
 ///////////////////
 //
@@ -42,18 +45,20 @@ std::pair<Precode_Result, DenseMtx> Precode_Matrix<IS_OFFLINE>::intermediate (
                                         bool &keep_working,
                                         const Work_State *thread_keep_working)
 {
+    if (!_sliced && D.cols() >= Schedule::min_sliced_cols)
+        return intermediate_sliced (D, ops, keep_working, thread_keep_working);
+
     // rfc 6330, pg 32
     // "c" and "d" are used to track row and columns exchange.
-    // since Eigen should track row exchange without actually swapping
-    // the data, we can call DenseMtx.row.swap without more overhead
-    // than actually having "d". so we're left only with "c",
+    // the solver works on a Symbol_Mtx, where row swaps only change
+    // the row table, so it already is our "d". so we're left only with "c",
     // which is needed 'cause D does not have _params.L columns.
 
     std::vector<uint16_t> c;
 
     c.clear();
     c.reserve (_params.L);
-    DenseMtx C, X = A;
+    DenseMtx C;
 
     bool success;
     uint16_t i, u;
@@ -63,31 +68,34 @@ std::pair<Precode_Result, DenseMtx> Precode_Matrix<IS_OFFLINE>::intermediate (
     DenseMtx CP_D;
     if (debug)
         CP_D = D;
-    std::tie (success, i, u) = decode_phase1 (X, D, c , ops,
+    Symbol_Mtx D_sym (D);
+    D = DenseMtx();     // free some memory, we work on D_sym now
+    std::tie (success, i, u) = decode_phase1 (D_sym, c , ops,
                                             keep_working, thread_keep_working);
     if (stop (keep_working, thread_keep_working))
         return std::make_pair (Precode_Result::STOPPED, DenseMtx());
     if (!success)
         return std::make_pair (Precode_Result::FAILED, DenseMtx());
 
-    success = decode_phase2 (D, i, u, ops, keep_working, thread_keep_working);
+    success = decode_phase2 (D_sym, i, u, ops, keep_working,
+                                                        thread_keep_working);
     if (stop (keep_working, thread_keep_working))
         return std::make_pair (Precode_Result::STOPPED, DenseMtx());
     if (!success)
         return std::make_pair (Precode_Result::FAILED, DenseMtx());
     // A now should be considered as being LxL from now
-    decode_phase3 (X, D, i, ops);
-    if (stop (keep_working, thread_keep_working))
-        return std::make_pair (Precode_Result::STOPPED, DenseMtx());
-
-    X = DenseMtx ();    // free some memory, X is not needed anymore.
-    decode_phase4 (D, i, u, ops, keep_working, thread_keep_working);
+    // rfc 6330 phase 3 multiplies the first i rows of A and D by X,
+    // a copy of the first i rows of A before phase 1, only to make
+    // U_upper sparse again. But after phase 1 the first i columns of
+    // the first i rows of A are already diagonal, so we skip it:
+    // phase 4 and 5 work with the U_upper that phase 1 left us.
+    decode_phase4 (D_sym, i, u, ops, keep_working, thread_keep_working);
     if (stop (keep_working, thread_keep_working))
         return std::make_pair (Precode_Result::STOPPED, DenseMtx());
     if (!success)
         return std::make_pair (Precode_Result::FAILED, DenseMtx());
 
-    decode_phase5 (D, i, ops, keep_working, thread_keep_working);
+    decode_phase5 (D_sym, i, ops, keep_working, thread_keep_working);
     if (stop (keep_working, thread_keep_working))
         return std::make_pair (Precode_Result::STOPPED, DenseMtx());
     if (!success)
@@ -103,26 +111,52 @@ std::pair<Precode_Result, DenseMtx> Precode_Matrix<IS_OFFLINE>::intermediate (
     //          return C;
     //  }
     //}
-    A = DenseMtx(); // free A memory.
+    A = Hybrid_Mtx(); // free A memory.
 
-    if (IS_OFFLINE == Save_Computation::ON)
+    if (record_ops())
         ops.emplace_back (Operation::_t::REORDER, c);
 
-    C = DenseMtx (_params.L, D.cols());
+    // only now the rows are put in their final place
+    C = DenseMtx (_params.L, D_sym.cols());
     for (i = 0; i < _params.L; ++i)
-        C.row (c[i]) = D.row (i);
+        std::memcpy (row_data (C, c[i]), D_sym.row (i), D_sym.cols());
 
     if (debug && ops.size() != 0) {
-        DenseMtx test_off (D.rows(), D.rows());
-        test_off.setIdentity (CP_D.rows(), CP_D.rows());
-        for (const auto &op : ops)
-            op.build_mtx (test_off);
-        DenseMtx test_res = test_off * CP_D;
-        assert (test_res == C && "RQ: I'm different!");
+        const Schedule test_off (ops, static_cast<uint32_t> (CP_D.rows()));
+        assert (test_off.replay (CP_D) == C && "RQ: I'm different!");
     }
     return std::make_pair (Precode_Result::DONE, C);
 }
 
+// All the operations on D are row operations, with the same scalars
+// for every column of D. With big symbols we solve with a single
+// column, as the encoder precomputation does, and then replay the
+// operations on column tiles of D, in parallel.
+template <Save_Computation IS_OFFLINE>
+std::pair<Precode_Result, DenseMtx>
+                            Precode_Matrix<IS_OFFLINE>::intermediate_sliced (
+                                        DenseMtx &D, Op_Vec &ops,
+                                        bool &keep_working,
+                                        const Work_State *thread_keep_working)
+{
+    Op_Vec sliced_ops;
+    DenseMtx D_col;
+    D_col.setZero (D.rows(), 1);
+    _sliced = true;
+    auto res = intermediate (D_col, sliced_ops, keep_working,
+                                                        thread_keep_working);
+    _sliced = false;
+    if (res.first != Precode_Result::DONE)
+        return res;
+
+    const Schedule schedule (sliced_ops, static_cast<uint32_t> (D.rows()));
+    res.second = schedule.replay (D);
+    D = DenseMtx();
+    if (IS_OFFLINE == Save_Computation::ON)
+        ops = std::move (sliced_ops);
+    return res;
+}
+
 template <Save_Computation IS_OFFLINE>
 std::pair<Precode_Result, DenseMtx> Precode_Matrix<IS_OFFLINE>::intermediate (
                                         DenseMtx &D, const Bitmask &mask,
@@ -146,8 +180,7 @@ DenseMtx Precode_Matrix<IS_OFFLINE>::get_missing (const DenseMtx &C,
     for (uint16_t hole = 0; hole < mask._max_nonrepair && holes > 0; ++hole) {
         if (mask.exists (hole))
             continue;
-        DenseMtx ret = encode (C, hole);
-        missing.row (row) = ret.row (0);
+        encode (C, hole, row_data (missing, row));
         ++row;
         --holes;
     }
@@ -174,6 +207,7 @@ void Precode_Matrix<IS_OFFLINE>::decode_phase0 (const Bitmask &mask,
 
     uint16_t holes = mask.get_holes();
     auto r_esi = repair_esi.begin();
+    uint16_t depends[Parameters::max_idxs];
 
     for (uint16_t hole_from = 0; hole_from < _params.L && holes > 0;
                                                                 ++hole_from) {
@@ -181,17 +215,14 @@ void Precode_Matrix<IS_OFFLINE>::decode_phase0 (const Bitmask &mask,
             continue;
         // now hole_from is the esi hole, and hole_to is our repair sym.
         // put the repair dependancy in the hole row
-        auto depends = _params.get_idxs (static_cast<uint16_t> (
-                                                            *r_esi + padding));
+        const uint16_t n = get_idxs (static_cast<uint16_t> (*r_esi + padding),
+                                                                    depends);
         ++r_esi;
         // erease the line, mark the dependencies of the repair symbol.
         const uint16_t row = hole_from + _params.H + _params.S;
-        for (uint16_t col = 0; col < A.cols(); ++col) {
-            A (row, col) = 0;
-        }
-        for (auto isi: depends) {
-            A (row, isi) = 1;
-        }
+        A.clear_row (row);
+        for (uint16_t idx = 0; idx < n; ++idx)
+            A.set (row, depends[idx], 1);
         --holes;
     }
     // we put the repair symbols in the right places,
@@ -199,335 +230,489 @@ void Precode_Matrix<IS_OFFLINE>::decode_phase0 (const Bitmask &mask,
     // symbols. And those have been compacted.
 
     for (uint16_t rep_row = static_cast<uint16_t> (
-                            static_cast<uint32_t>(A.rows()) - _repair_overhead);
+                                                A.rows() - _repair_overhead);
                                                 rep_row < A.rows(); ++rep_row) {
-        auto depends = _params.get_idxs (static_cast<uint16_t> (
-                                                            *r_esi + padding));
+        const uint16_t n = get_idxs (static_cast<uint16_t> (*r_esi + padding),
+                                                                    depends);
         ++r_esi;
         // erease the line, mark the dependencies of the repair symbol.
-        for (uint16_t col = 0; col < A.cols(); ++col) {
-            A (rep_row, col) = 0;
-        }
-        for (auto isi: depends) {
-            A (rep_row, isi) = 1;
-        }
+        A.clear_row (rep_row);
+        for (uint16_t idx = 0; idx < n; ++idx)
+            A.set (rep_row, depends[idx], 1);
     }
 }
 
 template <Save_Computation IS_OFFLINE>
 std::tuple<bool, uint16_t, uint16_t>
-    Precode_Matrix<IS_OFFLINE>::decode_phase1 (DenseMtx &X, DenseMtx &D,
+    Precode_Matrix<IS_OFFLINE>::decode_phase1 (Symbol_Mtx &D,
                                         std::vector<uint16_t> &c,
                                         Op_Vec &ops, bool &keep_working,
                                         const Work_State *thread_keep_working)
 {
     // rfc6330, page 33
-
-    std::vector<std::pair<bool, size_t>> tracking;  // is_hdpc, row_degree
-
-    // optimization: r_rows tracks the rows that can be chosen, and if the row
-    // is added to the graph, track also the id of one of the nodes with "1",
-    // so that it will be easy to verify it. The row represents an edge
-    // between nodes (1) of a maximum component (see rfc 6330, pg 33-34)
-    std::vector<std::pair<uint16_t, uint16_t>> r_rows;
-
-    tracking.reserve (static_cast<size_t> (A.rows()));
-
+    //
+    // The elimination never changes V: the chosen row has only one
+    // nonzero left in V (the others are moved to U), so the other rows
+    // only change in the first column of V, which then leaves V.
+    // This means that the nonzeros of each column of V are known from
+    // the beginning, and that the number of nonzeros in a row ("r")
+    // only goes down, when a column leaves V.
+    // So we never rescan V. We keep:
+    //  - col_rows: the rows with a nonzero in each column of V
+    //  - the degree ("r") and number of ones of each row, updated only
+    //    when columns leave V.
+    //  - a bucket (heap) of rows for each degree, ordered so that the top
+    //    is the rfc choice: non-HDPC first, then minimum original degree.
+    //  - the rows with r == 2 and two ones, and their graph, which is kept
+    //    across iterations.
+    // Rows are tracked by id (their index before any swap),
+    // columns by their original index (c[position]).
+    // Columns are never moved in A during this phase: "c" maps each
+    // position to its column, "in_V" marks the columns still in V.
+    // A is reordered only once, at the end.
+
+    using Bucket_Key = std::tuple<bool, size_t, uint16_t>; // hdpc,degree,id
+    using Min_Heap = std::greater<Bucket_Key>;
+
+    const uint16_t rows = static_cast<uint16_t> (A.rows());
     uint16_t i = 0;
     uint16_t u = _params.P;
 
-    auto V_tmp = A.block (0, 0, A.rows(), A.cols() - u);
-
-    // track hdpc rows and original degree of each row
-    for (uint16_t row = 0; row < V_tmp.rows(); ++row) {
-        size_t original_degree = 0;
-        for (uint16_t col = 0; col < V_tmp.cols(); ++col)
-            original_degree += static_cast<uint8_t> (V_tmp (row, col));
-        bool is_hdpc = (row >= _params.S && row < (_params.S + _params.H));
-        tracking.emplace_back (is_hdpc, original_degree);
+    std::vector<uint16_t> row_at, pos_of;   // position <-> row id
+    std::vector<uint16_t> degree, ones;
+    std::vector<size_t> original_degree;
+    std::vector<bool> is_hdpc, done;
+    std::vector<std::vector<uint16_t>> col_rows (_params.L);
+    std::vector<std::vector<Bucket_Key>> buckets (_params.L + 1);
+    std::vector<uint16_t> new_two_ones;
+    std::vector<uint16_t> col_pos (_params.L);    // inverse of "c"
+    std::vector<uint64_t> in_V ((_params.L + 63) / 64, 0);
+    std::vector<uint16_t> nonzero_pos;
+    Graph G = Graph (_params.L);
+
+    row_at.reserve (rows);
+    pos_of.reserve (rows);
+    degree.reserve (rows);
+    ones.reserve (rows);
+    original_degree.reserve (rows);
+    is_hdpc.reserve (rows);
+    done.resize (rows, false);
+
+    const auto add_to_bucket = [&] (const uint16_t id) {
+        auto &bucket = buckets[degree[id]];
+        bucket.emplace_back (is_hdpc[id], original_degree[id], id);
+        std::push_heap (bucket.begin(), bucket.end(), Min_Heap());
+    };
+    // the two columns of V with a "1" are connected by the row
+    const auto add_two_ones = [&] (const uint16_t id) {
+        if (is_hdpc[id])
+            return;
+        uint16_t cols[2];
+        uint8_t found = 0;
+        A.for_each_nonzero (pos_of[id], in_V, [&] (const uint32_t col) {
+            if (found < 2)
+                cols[found++] = static_cast<uint16_t> (col);
+        });
+        G.connect (cols[0], cols[1], id);
+    };
+    const auto swap_pos = [&] (const uint16_t pos_1, const uint16_t pos_2) {
+        std::swap (c[pos_1], c[pos_2]);     // rfc6330, pg32
+        col_pos[c[pos_1]] = pos_1;
+        col_pos[c[pos_2]] = pos_2;
+    };
+    const auto is_two_ones = [&] (const uint32_t id) {
+        return !done[id] && degree[id] == 2;
+    };
+
+    // track hdpc rows, original degree and nonzeros of each row
+    const uint16_t V_end_start = static_cast<uint16_t> (_params.L - u);
+    for (uint16_t col = 0; col < _params.L; ++col) {
+        col_pos[c[col]] = col;
+        if (col < V_end_start)
+            in_V[c[col] / 64] |= static_cast<uint64_t> (1) << (c[col] % 64);
+    }
+    uint16_t min_degree = static_cast<uint16_t> (_params.L);
+    for (uint16_t row = 0; row < rows; ++row) {
+        row_at.push_back (row);
+        pos_of.push_back (row);
+        is_hdpc.push_back (row >= _params.S && row < (_params.S + _params.H));
+        uint16_t non_zero = 0, row_ones = 0;
+        size_t degree_tmp = 0;
+        A.for_each_nonzero (row, in_V, [&] (const uint32_t col) {
+            const uint8_t val = static_cast<uint8_t> (A (row, col));
+            ++non_zero;
+            if (val == 1)
+                ++row_ones;
+            degree_tmp += val;
+            col_rows[col].push_back (row);
+        });
+        degree.push_back (non_zero);
+        ones.push_back (row_ones);
+        original_degree.push_back (degree_tmp);
+        if (non_zero == 0)
+            continue;
+        add_to_bucket (row);
+        min_degree = std::min (min_degree, non_zero);
+        if (non_zero == 2 && row_ones == 2)
+            add_two_ones (row);
     }
 
     while (i + u < _params.L) {
         if (stop (keep_working, thread_keep_working))
             return std::tuple<bool,uint16_t,uint16_t> (false, 0, 0); // stop
-        auto V = A.block (i, i, A.rows() - i, (A.cols() - i) - u);
-        uint16_t chosen = static_cast<uint16_t> (V.rows());
+        const uint16_t V_end = static_cast<uint16_t> (_params.L - u);
+
         // search for minium "r" (number of nonzero elements in row)
-        uint16_t non_zero = static_cast<uint16_t> (V.cols()) + 1;
-        bool only_two_ones = false;
-        r_rows.clear();
-        Graph G = Graph (static_cast<uint16_t> (V.cols()));
-
-        // build graph, get minimum non_zero and track rows that
-        // will be needed later
-        for (uint16_t row = 0; row < V.rows(); ++row) {
-            if (stop (keep_working, thread_keep_working))
-                return std::tuple<bool,uint16_t,uint16_t> (false, 0, 0); // stop
-            uint16_t non_zero_tmp = 0;
-            // if the row is NOT HDPC and has two ones,
-            // it represents an edge in a graph between the two columns with "1"
-            uint16_t ones = 0;
-            std::array<uint16_t, 2> ones_idx = {{0, 0}};
-            bool next_row = false;  // true => non_zero_tmp > zero_tmp
-            for (uint16_t col = 0; col < V.cols(); ++col) {
-                if (static_cast<uint8_t> (V (row, col)) != 0) {
-                    if (++non_zero_tmp > non_zero) {
-                        next_row = true;
-                        break;
-                    }
-                }
-                if (static_cast<uint8_t> (V (row, col)) == 1) {
-                    // count the ones and update ones_idx at the same time
-                    if (++ones <= 2)
-                        ones_idx[ones - 1] = col;
-                }
+        // drop the rows that were chosen or have changed degree.
+        uint16_t non_zero = min_degree;
+        for (; non_zero < buckets.size(); ++non_zero) {
+            auto &bucket = buckets[non_zero];
+            while (bucket.size() != 0) {
+                const uint16_t id = std::get<2> (bucket.front());
+                if (!done[id] && degree[id] == non_zero)
+                    break;
+                std::pop_heap (bucket.begin(), bucket.end(), Min_Heap());
+                bucket.pop_back();
             }
-            if (next_row || non_zero_tmp == 0)
-                continue;
-            // now non_zero >= non_zero_tmp, and both > 0
+            if (bucket.size() != 0)
+                break;
+        }
+        if (non_zero == buckets.size())
+            return std::tuple<bool,uint16_t,uint16_t> (false, 0, 0); // failure
+        min_degree = non_zero;
 
+        uint16_t chosen = rows;
+        if (non_zero == 2) {
             // rationale & optimization, rfc 6330 pg 34
-            // we need to track the rows that have the least number "r"
-            // of non-zero elements.
             // if r == 2 and even just one row has the two elements to "1",
-            // then we need to track only the rows with "1" in the two
-            // non-zero elements.
-            if (non_zero == non_zero_tmp) {
-                // do not add if "only_two_ones && ones != 2"
-                if (!only_two_ones || ones == 2)
-                    r_rows.emplace_back (row, ones_idx[0]);
-            } else {
-                // non_zero > non_zero_tmp)
-                non_zero = non_zero_tmp;
-                if (only_two_ones && non_zero == 1)
-                    only_two_ones = false;
-                r_rows.clear();
-                r_rows.emplace_back (row, ones_idx[0]);
-            }
-
-            if (ones == 2) {
-                // track the maximum component in the graph
-                if (non_zero == 2) {
-                    if (!tracking[row + i].first)   // if not HDPC row
-                        G.connect (ones_idx[0], ones_idx[1]);
-                    if (!only_two_ones) {
-                        // must keep only rows with two ones,
-                        // so delete the other ones.
-                        only_two_ones = true;
-                        r_rows.clear();
-                        r_rows.emplace_back (row, ones_idx[0]);
-                    }
-                }
-            }
+            // choose a row with two ones that is part of a maximum
+            // size component in the graph.
+            const uint32_t edge = G.max_edge (is_two_ones);
+            if (edge != Graph::no_edge)
+                chosen = static_cast<uint16_t> (edge);
         }
-        if (non_zero == V.cols() + 1)
-            return std::tuple<bool,uint16_t,uint16_t> (false, 0, 0); // failure
-        // search for r.
-        if (non_zero != 2) {
-            // search for row with minimum original degree.
-            // Precedence to non-hdpc
-            uint16_t min_row = static_cast<uint16_t> (V.rows());
-            uint16_t min_row_hdpc = min_row;
-            size_t min_degree = ~(static_cast<size_t> (0)); // max possible
-            size_t min_degree_hdpc = min_degree;
-            for (auto row_pair : r_rows) {
-                uint16_t row = row_pair.first;
-                if (tracking[row + i].first) {
-                    // HDPC
-                    if (tracking[row + i].second < min_degree_hdpc) {
-                        min_degree_hdpc = tracking[row + i].second;
-                        min_row_hdpc = row;
-                    }
-                } else {
-                    // NON-HDPC
-                    if (tracking[row + i].second < min_degree) {
-                        min_degree = tracking[row + i].second;
-                        min_row = row;
-                    }
-                }
-            }
-            if (min_row != V.rows()) {
-                chosen = min_row;
-            } else {
-                chosen = min_row_hdpc;
-            }
-        } else {
-            // non_zero == 2 => graph, else any r
-            if (only_two_ones) {
-                for (auto id : r_rows) {
-                    if (G.is_max (id.second)) {
-                        chosen = id.first;
-                        break;
-                    }
-                }
-            }
-            if (chosen == V.rows()) {
-                chosen = r_rows[0].first;
-            }
-        }   // done choosing
+        if (chosen == rows)
+            chosen = std::get<2> (buckets[non_zero].front());
+        done[chosen] = true;
 
         // swap chosen row and first V row in A (not just in V)
-        if (chosen != 0) {
-            A.row (i).swap (A.row (chosen + i));
-            X.row (i).swap (X.row (chosen + i));
-            D.row (i).swap (D.row (chosen + i));
-            std::swap (tracking[i], tracking[chosen + i]);
-            if (IS_OFFLINE == Save_Computation::ON)
-                ops.emplace_back (Operation::_t::SWAP, i, chosen + i);
+        const uint16_t chosen_pos = pos_of[chosen];
+        if (chosen_pos != i) {
+            A.swap_rows (i, chosen_pos);
+            D.swap_rows (i, chosen_pos);
+            std::swap (row_at[i], row_at[chosen_pos]);
+            pos_of[row_at[i]] = i;
+            pos_of[row_at[chosen_pos]] = chosen_pos;
+            if (record_ops())
+                ops.emplace_back (Operation::_t::SWAP, i, chosen_pos);
         }
-        // column swap in A. looking at the first V row,
-        // the first column must be nonzero, and the other non-zero must be
-        // put to the last columns of V.
-        if (static_cast<uint8_t> (V (0, 0)) == 0) {
-            uint16_t idx = 1;
-            for (; idx < V.cols(); ++idx) {
-                if (static_cast<uint8_t> (V (0, idx)) != 0)
-                    break;
-            }
-            A.col (i).swap (A.col (i + idx));
-            X.col (i).swap (X.col (i + idx));
-            std::swap (c[i], c[i + idx]);   // rfc6330, pg32
+        // looking at the first V row, the first column of V must be
+        // nonzero, and the other nonzeros must be put in the last columns
+        // of V. Only the positions in "c" are swapped.
+        nonzero_pos.clear();
+        A.for_each_nonzero (i, in_V, [&] (const uint32_t col) {
+            nonzero_pos.push_back (col_pos[col]);
+        });
+        uint16_t pivot_pos = i;
+        if (static_cast<uint8_t> (A (i, c[i])) == 0) {
+            pivot_pos = *std::min_element (nonzero_pos.begin(),
+                                                        nonzero_pos.end());
         }
-        uint16_t col = static_cast<uint16_t> (V.cols()) - 1;
-        uint16_t swap = 1;  // at most we swapped V(0,0)
-        if (stop (keep_working, thread_keep_working))
-            return std::tuple<bool,uint16_t,uint16_t> (false, 0, 0); // stop
-        // put all the non-zero cols to the last columns.
-        for (; col > V.cols() - non_zero; --col) {
-            if (static_cast<uint8_t> (V (0, col)) != 0)
+        swap_pos (i, pivot_pos);
+        const uint16_t tail = static_cast<uint16_t> (V_end - (non_zero - 1));
+        auto next = nonzero_pos.begin();
+        for (uint16_t col = tail; col < V_end; ++col) {
+            if (static_cast<uint8_t> (A (i, c[col])) != 0)
                 continue;
-            while (swap < col && static_cast<uint8_t> (V (0, swap)) == 0)
-                ++swap;
-
-            if (swap >= col)
-                break;  // line full of zeros, nothing to swap
-            // now V(0, col) == 0 and V(0, swap != 0. swap them
-            A.col (col + i).swap (A.col (swap + i));
-            X.col (col + i).swap (X.col (swap + i));
-            std::swap (c[col + i], c[swap + i]);    //rfc6330, pg32
+            while (*next == pivot_pos || *next >= tail)
+                ++next;
+            swap_pos (col, *next);
+            ++next;
         }
         if (stop (keep_working, thread_keep_working))
             return std::tuple<bool,uint16_t,uint16_t> (false, 0, 0); // stop
+
+        // the first column of V and the last (non_zero - 1) leave V:
+        // update the degree of the rows that had a nonzero there.
+        new_two_ones.clear();
+        for (uint16_t leaving = V_end - (non_zero - 1); ; ++leaving) {
+            if (leaving == V_end)
+                leaving = i;
+            G.remove (c[leaving]);
+            in_V[c[leaving] / 64] &= ~(static_cast<uint64_t> (1) <<
+                                                        (c[leaving] % 64));
+            for (const uint16_t id : col_rows[c[leaving]]) {
+                if (done[id])
+                    continue;
+                const uint8_t val = static_cast<uint8_t> (
+                                                A (pos_of[id], c[leaving]));
+                if (val == 0)
+                    continue;
+                --degree[id];
+                if (val == 1)
+                    --ones[id];
+                if (degree[id] == 0)
+                    continue;
+                add_to_bucket (id);
+                min_degree = std::min (min_degree, degree[id]);
+                if (degree[id] == 2 && ones[id] == 2)
+                    new_two_ones.push_back (id);
+            }
+            if (leaving == i)
+                break;
+        }
+
         // now add a multiple of the row V(0) to the other rows of *A* so that
         // the other rows of *V* have a zero first column.
-        for (uint16_t row = 1; row < V.rows(); ++row) {
-            if (static_cast<uint8_t> (V (row, 0)) != 0) {
-                const Octet multiple = V (row, 0) / V (0, 0);
-                A.row (row + i) += A.row (i) * multiple;
-                D.row (row + i) += D.row (i) * multiple;    //rfc6330, pg32
-                if (IS_OFFLINE == Save_Computation::ON) {
-                    ops.emplace_back (Operation::_t::ADD_MUL, row + i, i,
-                                                                    multiple);
-                }
+        const Octet pivot = A (i, c[i]);
+        for (const uint16_t id : col_rows[c[i]]) {
+            if (done[id])
+                continue;
+            const uint16_t row = pos_of[id];
+            if (static_cast<uint8_t> (A (row, c[i])) != 0) {
+                const Octet multiple = A (row, c[i]) / pivot;
+                A.add_mul (row, i, multiple);
+                D.add_mul (row, i, multiple);   //rfc6330, pg32
+                if (record_ops())
+                    ops.emplace_back (Operation::_t::ADD_MUL, row, i, multiple);
             }
         }
+        // the columns that left V will not be needed anymore
+        std::vector<uint16_t>().swap (col_rows[c[i]]);
+        for (uint16_t leaving = V_end - (non_zero - 1); leaving < V_end;
+                                                                    ++leaving) {
+            std::vector<uint16_t>().swap (col_rows[c[leaving]]);
+        }
 
         // finally increment i by 1, u by (non_zero - 1) and repeat.
         ++i;
         u += non_zero - 1;
+        for (const uint16_t id : new_two_ones)
+            add_two_ones (id);
     }
+    // the next phases work on contiguous blocks: move the columns now.
+    A.permute_cols (c);
 
     return std::make_tuple (true, i, u);
 }
 
 template<Save_Computation IS_OFFLINE>
-bool Precode_Matrix<IS_OFFLINE>::decode_phase2 (DenseMtx &D, const uint16_t i,
+bool Precode_Matrix<IS_OFFLINE>::decode_phase2 (Symbol_Mtx &D, const uint16_t i,
                                         const uint16_t u, Op_Vec &ops,
                                         bool &keep_working,
                                         const Work_State *thread_keep_working)
 {
     // rfc 6330, pg 35
+    //
+    // bring U_lower to identity with gaussian elimination.
+    // U_lower is dense and small (it's the inactivated columns), while
+    // the rows of D can be huge. So:
+    //  - we copy U_lower out of A and eliminate there, one row at a time.
+    //    A is never read again below row i, so we do not write it back.
+    //  - meanwhile we only save the row operations. rows are tracked
+    //    by "id": their offset from "i" when we start.
+    //  - then we apply them to D, one panel of pivots at a time: the
+    //    updates of the rows outside the panel become a single tiled
+    //    (rows x panel) * (panel x symbol) product.
+    //  - rows that do not end up in the identity are never read again,
+    //    so we skip their updates in D.
+    // Instead of eliminating above and below each pivot, we first
+    // eliminate below, then go up: that way a pivot row is final when
+    // it is used, and the panel updates can be grouped.
+
+    const uint16_t panel = 16;     // pivots applied together to D
+    const uint32_t rows = A.rows() - i;
+    const uint16_t U_col = static_cast<uint16_t> (A.cols() - u);
+    Symbol_Mtx U_lower (rows, u);
+    for (uint32_t row = 0; row < rows; ++row) {
+        uint8_t *out = U_lower.row (row);
+        for (uint16_t col = 0; col < u; ++col)
+            out[col] = static_cast<uint8_t> (A (i + row, U_col + col));
+    }
 
-    // U_Lower parameters (u x u):
-    const uint16_t row_start = i, row_end = static_cast<uint16_t> (A.rows());
-    const uint16_t col_start = static_cast<uint16_t> (A.cols() - u);
-    // try to bring U_Lower to Identity with gaussian elimination.
-    // remember that all row swaps affect A as well, not just U_Lower
+    struct Row_Op {
+        uint32_t id;
+        uint8_t mul;
+    };
+    std::vector<uint32_t> id_at (rows), pos_of (rows);  // position <-> id
+    std::vector<uint32_t> swapped_with (u);
+    std::vector<uint8_t> divisor (u, 1);
+    std::vector<std::vector<Row_Op>> down (u), up (u);
+    for (uint32_t row = 0; row < rows; ++row) {
+        id_at[row] = row;
+        pos_of[row] = row;
+    }
 
-    for (uint16_t row = row_start; row < row_end; ++row) {
+    // eliminate below the diagonal
+    for (uint16_t piv = 0; piv < u; ++piv) {
         if (stop (keep_working, thread_keep_working))
             return false; // stop
         // make sure the considered row has nonzero on the diagonal
-        uint16_t row_nonzero = row;
-        const uint16_t col_diag = col_start + (row - row_start);
-        if (col_diag >= _params.L)
-            break;
-        for (; row_nonzero < row_end; ++row_nonzero) {
-            if (static_cast<uint8_t> (A (row_nonzero, col_diag)) != 0) {
+        uint32_t row_nonzero = piv;
+        for (; row_nonzero < rows; ++row_nonzero) {
+            if (U_lower.row (row_nonzero)[piv] != 0)
                 break;
-            }
         }
-        if (row_nonzero == row_end) {
-            // U_Lower is square, we can return early (rank < u, not solvable)
+        // U_Lower is square, we can return early (rank < u, not solvable)
+        if (row_nonzero == rows)
             return false;
-        } else if (row != row_nonzero) {
-            A.row (row).swap (A.row (row_nonzero));
-            D.row (row).swap (D.row (row_nonzero));
-            if (IS_OFFLINE == Save_Computation::ON)
-                ops.emplace_back (Operation::_t::SWAP, row, row_nonzero);
+        swapped_with[piv] = row_nonzero;
+        if (row_nonzero != piv) {
+            U_lower.swap_rows (piv, row_nonzero);
+            std::swap (id_at[piv], id_at[row_nonzero]);
+            pos_of[id_at[piv]] = piv;
+            pos_of[id_at[row_nonzero]] = row_nonzero;
         }
-
         // U_Lower (row, row) != 0. make it 1.
-        if (static_cast<uint8_t> (A (row, col_diag)) > 1) {
-            const auto divisor = A (row, col_diag);
-            A.row (row) /= divisor;
-            D.row (row) /= divisor;
-            if (IS_OFFLINE == Save_Computation::ON)
-                ops.emplace_back (Operation::_t::DIV, row, divisor);
+        const uint8_t diag = U_lower.row (piv)[piv];
+        if (diag != 1) {
+            U_lower.div (piv, Octet (diag));
+            divisor[piv] = diag;
         }
-
-        // make U_Lower and identity up to row
-        for (uint16_t del_row = row_start; del_row < row_end; ++del_row) {
-            if (stop (keep_working, thread_keep_working))
-                return false;   // stop
-            if (del_row == row)
+        for (uint32_t row = piv + 1u; row < rows; ++row) {
+            const uint8_t multiple = U_lower.row (row)[piv];
+            if (multiple == 0)
                 continue;
-            // subtract row "row" to "del_row" enough times to make
-            // row "del_row" start with zero. but row "row" now starts
-            // with "1", so this is easy.
-            const auto multiple = A (del_row, col_diag);
-            if (static_cast<uint8_t> (multiple) != 0) {
-                A.row (del_row) -= A.row (row) * multiple;
-                D.row (del_row) -= D.row (row) * multiple;
-                if (IS_OFFLINE == Save_Computation::ON)
-                    ops.emplace_back (Operation::_t::ADD_MUL, del_row, row,
-                                                                    multiple);
-            }
+            U_lower.add_mul (row, piv, Octet (multiple));
+            down[piv].push_back ({id_at[row], multiple});
+        }
+    }
+    // and above it. Only the first u columns are left.
+    for (uint16_t piv = u; piv > 0; --piv) {
+        if (stop (keep_working, thread_keep_working))
+            return false; // stop
+        const uint16_t col = piv - 1;
+        for (uint16_t row = 0; row < col; ++row) {
+            const uint8_t multiple = U_lower.row (row)[col];
+            if (multiple == 0)
+                continue;
+            U_lower.add_mul (row, col, Octet (multiple));
+            up[col].push_back ({id_at[row], multiple});
         }
     }
-    // A should be resized to LxL.
-    // we don't really care, as we should not gain that much.
-    // A.conservativeResize (params.L, params.L);
-    return true;
-}
-
-template<Save_Computation IS_OFFLINE>
-void Precode_Matrix<IS_OFFLINE>::decode_phase3 (const DenseMtx &X, DenseMtx &D,
-                                                const uint16_t i, Op_Vec &ops)
-{
-    // rfc 6330, pg 35:
-    //  To this end, the matrix X is
-    //  multiplied with the submatrix of A consisting of the first i rows of
-    //  A. After this operation, the submatrix of A consisting of the
-    //  intersection of the first i rows and columns equals to X, whereas the
-    //  matrix U_upper is transformed to a sparse form.
-    const auto sub_X = X.block (0, 0, i, i);
-    if (IS_OFFLINE == Save_Computation::ON)
-        ops.emplace_back (Operation::_t::BLOCK, sub_X);
-
-    auto sub_A = A.block (0, 0, i, A.cols());
-    sub_A = sub_X * sub_A;
 
-    // Now fix D, too
-    DenseMtx D_2 = D;
+    // pivot index of each row id. u if the row is not used
+    std::vector<uint16_t> piv_of (rows, u);
+    for (uint16_t piv = 0; piv < u; ++piv)
+        piv_of[id_at[piv]] = piv;
 
-    D.block (0, 0, sub_X.cols(), D.cols()) = sub_X *
-                                        D_2.block (0,0, sub_X.cols(), D.cols());
+    // save the operations in order, with the position of the rows
+    if (record_ops()) {
+        for (uint32_t row = 0; row < rows; ++row) {
+            id_at[row] = row;
+            pos_of[row] = row;
+        }
+        for (uint16_t piv = 0; piv < u; ++piv) {
+            const uint32_t other = swapped_with[piv];
+            if (other != piv) {
+                ops.emplace_back (Operation::_t::SWAP, i + piv, i + other);
+                std::swap (id_at[piv], id_at[other]);
+                pos_of[id_at[piv]] = piv;
+                pos_of[id_at[other]] = other;
+            }
+            if (divisor[piv] != 1) {
+                ops.emplace_back (Operation::_t::DIV, i + piv,
+                                                        Octet (divisor[piv]));
+            }
+            for (const auto op : down[piv]) {
+                if (piv_of[op.id] == u)
+                    continue;
+                ops.emplace_back (Operation::_t::ADD_MUL, i + pos_of[op.id],
+                                                    i + piv, Octet (op.mul));
+            }
+        }
+        for (uint16_t piv = u; piv > 0; --piv) {
+            const uint16_t piv_row = i + piv - 1;
+            for (const auto op : up[piv - 1]) {
+                ops.emplace_back (Operation::_t::ADD_MUL, i + pos_of[op.id],
+                                                    piv_row, Octet (op.mul));
+            }
+        }
+    }
 
+    // now D. Rows are still in the starting order: row "id" is i + id.
+    std::vector<uint32_t> panel_rows, other_rows;
+    std::vector<uint8_t> mul;
+    for (uint16_t start = 0; start < u; start += panel) {
+        if (stop (keep_working, thread_keep_working))
+            return false; // stop
+        const uint16_t end = static_cast<uint16_t> (std::min (
+                                        static_cast<uint32_t> (u),
+                                        static_cast<uint32_t> (start) + panel));
+        // inside the panel, one row at a time
+        panel_rows.clear();
+        for (uint16_t piv = start; piv < end; ++piv) {
+            const uint32_t piv_row = i + id_at[piv];
+            if (divisor[piv] != 1)
+                D.div (piv_row, Octet (divisor[piv]));
+            for (const auto op : down[piv]) {
+                if (piv_of[op.id] < end)
+                    D.add_mul (i + op.id, piv_row, Octet (op.mul));
+            }
+            panel_rows.push_back (piv_row);
+        }
+        // the pivots of the next panels, all together
+        other_rows.clear();
+        for (uint16_t piv = end; piv < u; ++piv)
+            other_rows.push_back (i + id_at[piv]);
+        mul.assign (other_rows.size() * panel_rows.size(), 0);
+        for (uint16_t piv = start; piv < end; ++piv) {
+            for (const auto op : down[piv]) {
+                const uint16_t target = piv_of[op.id];
+                if (target >= end && target < u)
+                    mul[(target - end) * panel_rows.size() + (piv - start)] =
+                                                                        op.mul;
+            }
+        }
+        D.add_mul_rows (other_rows, panel_rows, mul);
+    }
+    for (uint16_t end = u; end > 0;) {
+        if (stop (keep_working, thread_keep_working))
+            return false; // stop
+        const uint16_t start = end > panel ? end - panel : 0;
+        panel_rows.clear();
+        for (uint16_t piv = end; piv > start; --piv) {
+            const uint32_t piv_row = i + id_at[piv - 1];
+            for (const auto op : up[piv - 1]) {
+                if (piv_of[op.id] >= start)
+                    D.add_mul (i + op.id, piv_row, Octet (op.mul));
+            }
+        }
+        for (uint16_t piv = start; piv < end; ++piv)
+            panel_rows.push_back (i + id_at[piv]);
+        other_rows.clear();
+        for (uint16_t piv = 0; piv < start; ++piv)
+            other_rows.push_back (i + id_at[piv]);
+        mul.assign (other_rows.size() * panel_rows.size(), 0);
+        for (uint16_t piv = start; piv < end; ++piv) {
+            for (const auto op : up[piv]) {
+                const uint16_t target = piv_of[op.id];
+                if (target < start)
+                    mul[target * panel_rows.size() + (piv - start)] = op.mul;
+            }
+        }
+        D.add_mul_rows (other_rows, panel_rows, mul);
+        end = start;
+    }
+    // finally put the rows of D in the same order of the operations
+    for (uint32_t row = 0; row < rows; ++row)
+        pos_of[row] = row;
+    std::vector<uint32_t> at (pos_of);  // position -> id, in D
+    for (uint16_t piv = 0; piv < u; ++piv) {
+        const uint32_t id = id_at[piv];
+        const uint32_t from = pos_of[id];
+        if (from == piv)
+            continue;
+        D.swap_rows (i + piv, i + from);
+        std::swap (at[piv], at[from]);
+        pos_of[at[piv]] = piv;
+        pos_of[at[from]] = from;
+    }
+    return true;
 }
 
 template<Save_Computation IS_OFFLINE>
-void Precode_Matrix<IS_OFFLINE>::decode_phase4 (DenseMtx &D, const uint16_t i,
+void Precode_Matrix<IS_OFFLINE>::decode_phase4 (Symbol_Mtx &D, const uint16_t i,
                                         const uint16_t u, Op_Vec &ops,
                                         bool &keep_working,
                                         const Work_State *thread_keep_working)
@@ -538,33 +723,32 @@ void Precode_Matrix<IS_OFFLINE>::decode_phase4 (DenseMtx &D, const uint16_t i,
     // entry is b, then add to this row b times row j of I_u
 
     // basically: zero out U_upper. we still need to update D each time, though.
+    // U_upper is what phase 1 left, we do not have phase 3.
 
-    auto U_upper = A.block (0, A.cols() - u, i, u);
-    for (uint16_t row = 0; row < U_upper.rows(); ++row) {
+    const uint16_t U_col = static_cast<uint16_t> (A.cols() - u);
+    std::vector<uint64_t> U_cols ((A.cols() + 63) / 64, 0);
+    for (uint32_t col = U_col; col < A.cols(); ++col)
+        U_cols[col / 64] |= static_cast<uint64_t> (1) << (col % 64);
+    for (uint16_t row = 0; row < i; ++row) {
         if (stop (keep_working, thread_keep_working))
             return;
-        for (uint16_t col = 0; col < U_upper.cols(); ++col) {
-            // col == j
-            auto multiple = U_upper (row, col);
-            if (static_cast<uint8_t> (multiple) != 0) {
-                // U_upper is never read again, so we can avoid some writes
-                //U_upper (row, col) = 0;
-
-                // "b times row j of I_u" => row "j" in U_lower.
-                // aka: U_upper.rows() + j
-                uint16_t row_2 = static_cast<uint16_t> (U_upper.rows()) + col;
-                D.row (row) += D.row (row_2) * multiple;
-                if (IS_OFFLINE == Save_Computation::ON) {
-                    ops.emplace_back (Operation::_t::ADD_MUL, row, row_2,
-                                                                    multiple);
-                }
-            }
-        }
+        A.for_each_nonzero (row, U_cols, [&] (const uint32_t col) {
+            // U_upper is never read again, so we can avoid some writes
+            //U_upper (row, col) = 0;
+
+            // "b times row j of I_u" => row "j" in U_lower.
+            // aka: U_upper.rows() + j
+            const auto multiple = A (row, col);
+            const uint16_t row_2 = static_cast<uint16_t> (i + (col - U_col));
+            D.add_mul (row, row_2, multiple);
+            if (record_ops())
+                ops.emplace_back (Operation::_t::ADD_MUL, row, row_2, multiple);
+        });
     }
 }
 
 template<Save_Computation IS_OFFLINE>
-void Precode_Matrix<IS_OFFLINE>::decode_phase5 (DenseMtx &D, const uint16_t i,
+void Precode_Matrix<IS_OFFLINE>::decode_phase5 (Symbol_Mtx &D, const uint16_t i,
                                         Op_Vec &ops, bool &keep_working,
                                         const Work_State *thread_keep_working)
 {
@@ -577,6 +761,9 @@ void Precode_Matrix<IS_OFFLINE>::decode_phase5 (DenseMtx &D, const uint16_t i,
     // 2.  For l from 1 to j-1, if A[j,l] is nonzero, then add A[j,l]
     //     multiplied with row l of A to row j of A.
     //
+    // Without phase 3 the first i rows and columns of A are diagonal,
+    // so step 2 never finds a nonzero: we only divide.
+    // A is not read again, so only D is changed.
 
     for (uint16_t j = 0; j < i; ++j) {
         if (stop (keep_working, thread_keep_working))
@@ -584,55 +771,69 @@ void Precode_Matrix<IS_OFFLINE>::decode_phase5 (DenseMtx &D, const uint16_t i,
         if (static_cast<uint8_t> (A (j, j)) != 1) {
             // A(j, j) is actually never 0, by construction.
             const auto multiple = A (j, j);
-            A.row (j) /= multiple;
-            D.row (j) /= multiple;
-            if (IS_OFFLINE == Save_Computation::ON)
+            D.div (j, multiple);
+            if (record_ops())
                 ops.emplace_back (Operation::_t::DIV, j, multiple);
         }
-        for (uint16_t col = 0; col < j; ++col) {    // col == "l" in rfc6330
-            const auto multiple = A (j, col);
-            if (static_cast<uint8_t> (multiple) != 0) {
-                // this row of A is not read again, so we can avoid making
-                // this ADD_MUL on A
-                // A.row (j) += A.row (col) * multiple;
-                D.row (j) += D.row (col) * multiple;
-                if (IS_OFFLINE == Save_Computation::ON)
-                    ops.emplace_back (Operation::_t::ADD_MUL, j, col, multiple);
-            }
-        }
     }
 }
 
 template<Save_Computation IS_OFFLINE>
-DenseMtx Precode_Matrix<IS_OFFLINE>::encode (const DenseMtx &C,
-                                                    const uint32_t ISI) const
+void Precode_Matrix<IS_OFFLINE>::encode (const DenseMtx &C, const uint32_t ISI,
+                                                        uint8_t *out) const
 {
-    // Generate repair symbols. same algorithm as "get_idxs"
+    // Generate repair symbols: the sum of the symbols the ISI depends on.
     // rfc6330, pg29
 
-    DenseMtx ret;
+    uint16_t idxs[Parameters::max_idxs];
+    const uint16_t n = get_idxs (ISI, idxs);
 
-    ret = DenseMtx (1, C.cols());
-    Tuple t = _params.tuple (ISI);
-
-    ret.row (0) = C.row (t.b);
-
-    for (uint16_t j = 1; j < t.d; ++j) {
-        t.b = (t.b + t.a) % _params.W;
-        ret.row (0) += C.row (t.b);
-    }
-    while (t.b1 >= _params.P)
-        t.b1 = (t.b1 + t.a1) % _params.P1;
-
-    ret.row (0) += C.row (_params.W + t.b1);
-    for (uint16_t j = 1; j < t.d1; ++j) {
-        t.b1 = (t.b1 + t.a1) % _params.P1;
-        while (t.b1 >= _params.P)
-            t.b1 = (t.b1 + t.a1) % _params.P1;
-        ret.row (0) += C.row (_params.W + t.b1);
+    const uint8_t *src[Parameters::max_idxs];
+    uint8_t mul[Parameters::max_idxs];
+    for (uint16_t idx = 1; idx < n; ++idx) {
+        src[idx - 1] = row_data (C, idxs[idx]);
+        mul[idx - 1] = 1;
     }
+    const size_t bytes = static_cast<size_t> (C.cols());
+    std::memcpy (out, row_data (C, idxs[0]), bytes);
+    GF256::add_mul_sum (out, src, mul, n - 1u, bytes);
+}
 
-    return ret;
+template<Save_Computation IS_OFFLINE>
+void Precode_Matrix<IS_OFFLINE>::encode (const DenseMtx &C, const uint32_t ISI,
+                                            const uint32_t count, uint8_t *out,
+                                            const size_t stride) const
+{
+    // Same as the single symbol encode, but we compute the indexes of a
+    // whole batch of symbols, then go through the columns of C in tiles:
+    // the rows used by a symbol are often used by the next ones too,
+    // so they are still in cache.
+    uint16_t idxs[encode_batch][Parameters::max_idxs];
+    uint16_t n[encode_batch];
+    const uint8_t *src[Parameters::max_idxs];
+    uint8_t mul[Parameters::max_idxs];
+    std::fill (mul, mul + Parameters::max_idxs, 1);
+
+    const size_t bytes = static_cast<size_t> (C.cols());
+    // tiles are a multiple of the widest SIMD block, and not too small
+    size_t width = (l2_bytes / static_cast<size_t> (C.rows())) & ~size_t (255);
+    width = std::min (bytes, std::max (width, static_cast<size_t> (min_tile)));
+    for (uint32_t first = 0; first < count; first += encode_batch) {
+        const uint32_t size = std::min (static_cast<uint32_t> (encode_batch),
+                                                                count - first);
+        for (uint32_t sym = 0; sym < size; ++sym)
+            n[sym] = get_idxs (ISI + first + sym, idxs[sym]);
+        for (size_t from = 0; from < bytes; from += width) {
+            const size_t len = std::min (width, bytes - from);
+            for (uint32_t sym = 0; sym < size; ++sym) {
+                uint8_t *dst = out + (first + sym) * stride + from;
+                for (uint16_t idx = 1; idx < n[sym]; ++idx)
+                    src[idx - 1] = row_data (C, idxs[sym][idx]) + from;
+                std::memcpy (dst, row_data (C, idxs[sym][0]) + from, len);
+                GF256::add_mul_sum (dst, src, mul, n[sym] - 1u, len);
+            }
+        }
+    }
 }
 
 }   // namespace RaptorQ
@@ -31,6 +31,7 @@
 #include <algorithm>
 #include <atomic>
 #include <cmath>
+#include <cstring>
 #include <deque>
 #include <future>
 #include <limits>
@@ -90,6 +91,12 @@ public:
 
     bool has_data() const;
     size_t set_data (const Rnd_It &from, const Rnd_It &to);
+    // online encoding, instead of set_data: give the source symbols one
+    // at a time, in any order. The intermediate symbols are updated with
+    // each one, so the repair symbols are ready right after the last.
+    // A short symbol is padded with zeros.
+    Error add_source_symbol (Rnd_It &from, const Rnd_It to,
+                                                        const uint16_t esi);
     void clear_data();
     bool ready() const;
     void stop();
@@ -98,8 +105,23 @@ public:
     bool compute_sync();
     std::shared_future<Error> precompute();
     std::shared_future<Error> compute();
+    // compute many encoders with the same number of symbols at once.
+    // Their data goes through a single replay of the precomputation,
+    // which is much faster than computing small symbols one block at
+    // a time. All the encoders must have their data.
+    static bool compute_batch (Encoder *const *encoders, const size_t count);
+    // the repair symbols [symbols(), symbols() + repairs) will be
+    // computed straight from the source symbols, with a cached
+    // generator matrix: no computation needed for them.
+    // Only worth it for a few repair symbols.
+    bool set_fixed_repairs (const uint32_t repairs);
 
     size_t encode (Fwd_It &output, const Fwd_It end, const uint32_t id);
+    // "count" symbols starting from "first_id", each one "stride" bytes
+    // after the previous one in "output" (0: just after it).
+    // returns the number of symbols written.
+    uint32_t encode_range (const uint32_t first_id, const uint32_t count,
+                                        void *output, const size_t stride);
 
 private:
     enum class Enc_State : uint8_t {
@@ -112,7 +134,7 @@ private:
     const uint16_t _symbols;
     Enc_State _state;
     Raw_Encoder<Rnd_It, Fwd_It, without_interleaver> encoder;
-    DenseMtx precomputed;
+    Schedule precomputed;
     Rnd_It _from, _to;
     // avoid launching multiple computations for the encoder.
     // it is guaranteed to succeed anyway.
@@ -123,6 +145,8 @@ private:
     static void compute_thread (Encoder<Rnd_It, Fwd_It> *obj,
                                                     bool forced_precomputation,
                                                     std::promise<Error> p);
+    // only get the schedule, without computing the symbols
+    bool load_precomputed();
 };
 
 template <typename In_It, typename Fwd_It>
@@ -159,6 +183,7 @@ public:
     uint16_t needed_symbols() const;
 
     void set_max_concurrency (const uint16_t max_threads);
+    void set_online (const bool online);
     Decoder_Result decode_once();
 
     struct Decoder_wait_res poll();
@@ -314,6 +339,41 @@ size_t Encoder<Rnd_It, Fwd_It>::set_data (const Rnd_It &from, const Rnd_It &to)
                     sizeof(typename std::iterator_traits<Rnd_It>::value_type);
 }
 
+template <typename Rnd_It, typename Fwd_It>
+Error Encoder<Rnd_It, Fwd_It>::add_source_symbol (Rnd_It &from,
+                                                        const Rnd_It to,
+                                                        const uint16_t esi)
+{
+    if (_state == Enc_State::INIT_ERROR)
+        return Error::INITIALIZATION;
+    if (_state == Enc_State::FULL)
+        return Error::NOT_NEEDED;
+    if (esi >= _symbols)
+        return Error::WRONG_INPUT;
+    // we need the schedule to know the matrix
+    if (precomputed.empty()) {
+        precompute_sync();
+        if (precomputed.empty())
+            return Error::EXITING;
+    }
+    using T = typename std::iterator_traits<Rnd_It>::value_type;
+    std::vector<uint8_t> symbol (_symbol_size, 0);
+    size_t byte = 0;
+    for (; from != to && byte < _symbol_size; ++from) {
+        const T val = *from;
+        const size_t size = std::min (sizeof(T), _symbol_size - byte);
+        std::memcpy (symbol.data() + byte, &val, size);
+        byte += size;
+    }
+    std::lock_guard<std::mutex> lock (_mtx);
+    RQ_UNUSED (lock);
+    const Error ret = encoder.add_source_symbol (precomputed, esi,
+                                                                symbol.data());
+    if (ret == Error::NONE && encoder.ready())
+        _state = Enc_State::FULL;
+    return ret;
+}
+
 template <typename Rnd_It, typename Fwd_It>
 void Encoder<Rnd_It, Fwd_It>::clear_data()
 {
@@ -392,9 +452,9 @@ void Encoder<Rnd_It, Fwd_It>::compute_thread (
     static RaptorQ__v1::Work_State work = RaptorQ__v1::Work_State::KEEP_WORKING;
 
     if (force_precomputation) {
-        if (obj->precomputed.rows() == 0)
+        if (obj->precomputed.empty())
             obj->precomputed = obj->encoder.get_precomputed (&work);
-        if (obj->precomputed.rows() == 0) {
+        if (obj->precomputed.empty()) {
             // encoder always works. only possible reason:
             p.set_value (Error::EXITING);
             return;
@@ -420,9 +480,9 @@ void Encoder<Rnd_It, Fwd_It>::compute_thread (
                 return;
             }
         } else {
-            if (obj->precomputed.rows() == 0) {
+            if (obj->precomputed.empty()) {
                 obj->precomputed = obj->encoder.get_precomputed (&work);
-                if (obj->precomputed.rows() == 0) {
+                if (obj->precomputed.empty()) {
                     // only possible reason:
                     p.set_value (Error::EXITING);
                     return;
@@ -481,6 +541,77 @@ std::shared_future<Error> Encoder<Rnd_It, Fwd_It>::compute()
     return _single_wait;
 }
 
+template <typename Rnd_It, typename Fwd_It>
+bool Encoder<Rnd_It, Fwd_It>::compute_batch (Encoder *const *encoders,
+                                                            const size_t count)
+{
+    if (encoders == nullptr)
+        return false;
+    std::vector<Encoder*> todo;
+    todo.reserve (count);
+    Encoder *with_schedule = nullptr;
+    for (size_t idx = 0; idx < count; ++idx) {
+        Encoder *enc = encoders[idx];
+        if (enc == nullptr || enc->_state != Enc_State::FULL ||
+                                    enc->_symbols != encoders[0]->_symbols) {
+            return false;
+        }
+        // do not race with a computation that was already started
+        if (enc->_single_wait.valid())
+            enc->_single_wait.wait();
+        if (!enc->precomputed.empty())
+            with_schedule = enc;
+        if (!enc->encoder.ready())
+            todo.push_back (enc);
+    }
+    if (todo.empty())
+        return true;
+    // nothing to share
+    if (todo.size() == 1 && with_schedule == nullptr)
+        return todo[0]->compute_sync() && todo[0]->encoder.ready();
+    if (with_schedule == nullptr) {
+        with_schedule = encoders[0];
+        if (!with_schedule->load_precomputed())
+            return false;
+    }
+    std::vector<Raw_Encoder<Rnd_It, Fwd_It, without_interleaver>*> raw;
+    raw.reserve (todo.size());
+    for (Encoder *enc : todo)
+        raw.push_back (&enc->encoder);
+    return Raw_Encoder<Rnd_It, Fwd_It, without_interleaver>::generate_batch (
+                            with_schedule->precomputed, raw.data(), raw.size());
+}
+
+template <typename Rnd_It, typename Fwd_It>
+bool Encoder<Rnd_It, Fwd_It>::load_precomputed()
+{
+    static RaptorQ__v1::Work_State work = RaptorQ__v1::Work_State::KEEP_WORKING;
+
+    // do not race with a computation that was already started
+    if (_single_wait.valid())
+        _single_wait.wait();
+    std::lock_guard<std::mutex> lock (_mtx);
+    RQ_UNUSED (lock);
+    if (precomputed.empty())
+        precomputed = encoder.get_precomputed (&work);
+    return !precomputed.empty();
+}
+
+template <typename Rnd_It, typename Fwd_It>
+bool Encoder<Rnd_It, Fwd_It>::set_fixed_repairs (const uint32_t repairs)
+{
+    if (_state == Enc_State::INIT_ERROR || repairs == 0 ||
+                                                    repairs > max_repair()) {
+        return false;
+    }
+    // G might be in the cache, then we do not need the schedule.
+    if (encoder.gen_generator (precomputed, repairs))
+        return true;
+    if (!load_precomputed())
+        return false;
+    return encoder.gen_generator (precomputed, repairs);
+}
+
 template <typename Rnd_It, typename Fwd_It>
 size_t Encoder<Rnd_It, Fwd_It>::encode (Fwd_It &output, const Fwd_It end,
                                                             const uint32_t id)
@@ -490,7 +621,7 @@ size_t Encoder<Rnd_It, Fwd_It>::encode (Fwd_It &output, const Fwd_It end,
     // returns number of iterators written
     if (_state == Enc_State::FULL) {
         if (id >= _symbols) { // repair symbol
-            if (!encoder.ready()) {
+            if (!encoder.ready() && !encoder.from_generator (id)) {
                 if (!_single_wait.valid())
                     _single_wait = compute();
                 _single_wait.wait();
@@ -501,6 +632,31 @@ size_t Encoder<Rnd_It, Fwd_It>::encode (Fwd_It &output, const Fwd_It end,
     return 0;
 }
 
+template <typename Rnd_It, typename Fwd_It>
+uint32_t Encoder<Rnd_It, Fwd_It>::encode_range (const uint32_t first_id,
+                                                        const uint32_t count,
+                                                        void *output,
+                                                        const size_t stride)
+{
+    if (_state != Enc_State::FULL || output == nullptr || count == 0)
+        return 0;
+    const uint64_t last = static_cast<uint64_t> (_symbols) + max_repair();
+    if (first_id >= last)
+        return 0;
+    const uint32_t size = static_cast<uint32_t> (std::min (
+                            static_cast<uint64_t> (count), last - first_id));
+    // the fixed repair set does not need the computation
+    if (!encoder.ready() && (!encoder.from_generator (first_id) ||
+                            !encoder.from_generator (first_id + size - 1))) {
+        if (!_single_wait.valid())
+            _single_wait = compute();
+        _single_wait.wait();
+    }
+    return encoder.encode_range (first_id, size,
+                                    reinterpret_cast<uint8_t*> (output),
+                                    stride == 0 ? _symbol_size : stride);
+}
+
 ///////////////////
 //// Decoder
 ///////////////////
@@ -813,6 +969,13 @@ void Decoder<In_It, Fwd_It>::set_max_concurrency (const uint16_t max_threads)
         _max_threads = max_threads;
 }
 
+template <typename In_It, typename Fwd_It>
+void Decoder<In_It, Fwd_It>::set_online (const bool online)
+{
+    if (symbols_tracker.size() != 0)
+        dec.set_online (online);
+}
+
 template <typename In_It, typename Fwd_It>
 Decoder_Result Decoder<In_It, Fwd_It>::decode_once()
 {
@@ -0,0 +1,743 @@
+/*
+ * Copyright (c) 2015-2016, Luca Fulchir<luca@fulchir.it>, All rights reserved.
+ *
+ * This file is part of "libRaptorQ".
+ *
+ * libRaptorQ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * libRaptorQ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * and a copy of the GNU Lesser General Public License
+ * along with libRaptorQ.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "RaptorQ/v1/common.hpp"
+#include "RaptorQ/v1/Octet.hpp"
+#include "RaptorQ/v1/Operation.hpp"
+#include "RaptorQ/v1/Symbol_Mtx.hpp"
+#include "RaptorQ/v1/Thread_Pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace RaptorQ__v1 {
+namespace Impl {
+
+// The operations recorded by the precode solver, compiled in a flat
+// array of 32 bit words.
+// Replaying the schedule on the "in_rows()" symbols D gives the same
+// result as the solver, in O(operations * symbol size), and it is
+// much smaller than the equivalent (out_rows x in_rows) matrix,
+// so this is what the DLF cache keeps.
+//
+// Each record starts with a word with the record type in the low 8 bits
+// and the scalar (if any) in the next 8, followed by:
+//  SWAP:    row_1, row_2
+//  ADD_MUL: dst, src           (dst += src * scalar)
+//  DIV:     row                (row /= scalar)
+//  REORDER: size, from[0] ... from[size - 1]
+//                              (keep "size" rows, row k was row from[k])
+//  ACCUM:   dst, count, src[0] ... src[count - 1], scalars
+//                              (dst += sum (src[s] * scalar[s]), the
+//                               scalars are packed 4 per word)
+class RAPTORQ_LOCAL Schedule
+{
+public:
+    Schedule() = default;
+    // compile and optimize the operations, for a D of "rows" rows
+    Schedule (const std::deque<Operation> &ops, const uint32_t rows)
+        : _in_rows (rows), _out_rows (rows)
+    {
+        for (const auto &op : ops)
+            op.compile (*this);
+        optimize();
+    }
+    enum : uint32_t { min_sliced_cols = 16 * 1024 };
+
+    Schedule (const Schedule&) = default;
+    Schedule& operator= (const Schedule&) = default;
+    Schedule (Schedule&&) = default;
+    Schedule& operator= (Schedule&&) = default;
+    ~Schedule() = default;
+
+    bool empty() const
+        { return _in_rows == 0; }
+    uint32_t in_rows() const
+        { return _in_rows; }
+    uint32_t out_rows() const
+        { return _out_rows; }
+
+    void add_swap (const uint32_t row_1, const uint32_t row_2)
+    {
+        _code.push_back (header (Record::SWAP, Octet (0)));
+        _code.push_back (row_1);
+        _code.push_back (row_2);
+    }
+    void add_add_mul (const uint32_t dst, const uint32_t src,
+                                                        const Octet scalar)
+    {
+        _code.push_back (header (Record::ADD_MUL, scalar));
+        _code.push_back (dst);
+        _code.push_back (src);
+    }
+    void add_div (const uint32_t row, const Octet scalar)
+    {
+        _code.push_back (header (Record::DIV, scalar));
+        _code.push_back (row);
+    }
+    // same as Symbol_Mtx::reorder_rows: row r goes in order[r]
+    void add_reorder (const std::vector<uint16_t> &order)
+    {
+        _code.push_back (header (Record::REORDER, Octet (0)));
+        _code.push_back (static_cast<uint32_t> (order.size()));
+        const size_t from = _code.size();
+        _code.resize (from + order.size());
+        for (uint32_t r = 0; r < order.size(); ++r)
+            _code[from + order[r]] = r;
+        _out_rows = static_cast<uint32_t> (order.size());
+    }
+
+    // D must have in_rows() rows. at the end it will have out_rows().
+    // With big enough symbols the records before the first SWAP or REORDER
+    // are run in parallel on the Thread_Pool, see replay_parallel()
+    void replay (Symbol_Mtx &D) const
+    {
+        const uint32_t *code = _code.data();
+        const uint32_t *end = code + _code.size();
+        code = replay_parallel (D);
+        while (code != end)
+            code = run (D, code);
+    }
+    // With symbols of at least min_sliced_cols bytes the columns of D
+    // are split in tiles, and the tiles are replayed in parallel,
+    // see replay_sliced()
+    DenseMtx replay (const DenseMtx &D) const
+    {
+        if (empty() || static_cast<uint32_t> (D.rows()) != _in_rows)
+            return DenseMtx();
+        if (D.cols() >= min_sliced_cols)
+            return replay_sliced (D);
+        Symbol_Mtx sym (D);
+        replay (sym);
+        return sym.to_dense();
+    }
+
+    // for the cache
+    std::vector<uint8_t> to_raw() const
+    {
+        std::vector<uint32_t> words;
+        words.reserve (_code.size() + 3);
+        words.push_back (raw_version);
+        words.push_back (_in_rows);
+        words.push_back (_out_rows);
+        words.insert (words.end(), _code.begin(), _code.end());
+        std::vector<uint8_t> ret (words.size() * sizeof(uint32_t));
+        std::memcpy (ret.data(), words.data(), ret.size());
+        return ret;
+    }
+    // returns an empty schedule if "raw" is not a valid schedule
+    static Schedule from_raw (const std::vector<uint8_t> &raw)
+    {
+        Schedule ret;
+        if (raw.size() < 3 * sizeof(uint32_t) || raw.size() % 4 != 0)
+            return ret;
+        std::vector<uint32_t> words (raw.size() / sizeof(uint32_t));
+        std::memcpy (words.data(), raw.data(), raw.size());
+        if (words[0] != raw_version)
+            return ret;
+        ret._code.assign (words.begin() + 3, words.end());
+        ret._in_rows = words[1];
+        ret._out_rows = words[2];
+        if (!ret.valid())
+            return Schedule();
+        return ret;
+    }
+
+private:
+    enum class Record : uint8_t {
+        SWAP = 0x01,
+        ADD_MUL = 0x02,
+        DIV = 0x03,
+        REORDER = 0x05,
+        ACCUM = 0x06
+    };
+    enum : uint32_t { raw_version = 0x52510002 };
+
+    uint32_t _in_rows = 0, _out_rows = 0;
+    std::vector<uint32_t> _code;
+
+    static uint32_t header (const Record type, const Octet scalar)
+    {
+        return static_cast<uint32_t> (type) |
+                            (static_cast<uint32_t> (
+                                        static_cast<uint8_t> (scalar)) << 8);
+    }
+    static size_t accum_words (const uint32_t count)
+        { return 3 + count + (count + 3) / 4; }
+
+    void optimize();
+    bool valid() const;
+
+    // run the record at "code", return the next one
+    static const uint32_t* run (Symbol_Mtx &D, const uint32_t *code)
+    {
+        const Octet scalar = Octet (static_cast<uint8_t> (*code >> 8));
+        switch (static_cast<Record> (*code & 0xFF)) {
+        case Record::SWAP:
+            D.swap_rows (code[1], code[2]);
+            return code + 3;
+        case Record::ADD_MUL:
+            D.add_mul (code[1], code[2], scalar);
+            return code + 3;
+        case Record::DIV:
+            D.div (code[1], scalar);
+            return code + 2;
+        case Record::REORDER:
+            D.select_rows (code + 2, code[1]);
+            return code + 2 + code[1];
+        case Record::ACCUM:
+            D.add_mul_sum (code[1], code + 3,
+                            reinterpret_cast<const uint8_t *> (
+                                                    code + 3 + code[2]),
+                                                                code[2]);
+            return code + accum_words (code[2]);
+        }
+        return code;
+    }
+
+    static size_t record_words (const uint32_t *code)
+    {
+        switch (static_cast<Record> (*code & 0xFF)) {
+        case Record::SWAP:
+        case Record::ADD_MUL:
+            return 3;
+        case Record::DIV:
+            return 2;
+        case Record::REORDER:
+            return 2 + code[1];
+        case Record::ACCUM:
+            return accum_words (code[2]);
+        }
+        return 1;
+    }
+
+    // parallel replay is only tried with at least this symbol size,
+    // and only used if each wavefront moves on average at least
+    // min_wave_bytes of symbols: the wait at the end of each wavefront
+    // must be negligible.
+    enum : size_t { min_parallel_stride = 4096,
+                    min_wave_bytes = 256 * 1024 };
+    const uint32_t* replay_parallel (Symbol_Mtx &D) const;
+    friend class Wavefront_Replay;
+
+    // column tiles are about l2_bytes for all the rows, but never less
+    // than min_tile_cols bytes wide, or the time spent decoding the
+    // records would be more than the time spent on the symbols.
+    enum : size_t { l2_bytes = 1024 * 1024,
+                    min_tile_cols = 4096 };
+    DenseMtx replay_sliced (const DenseMtx &D) const;
+    void replay_sequential (Symbol_Mtx &D) const
+    {
+        const uint32_t *code = _code.data();
+        const uint32_t *end = code + _code.size();
+        while (code != end)
+            code = run (D, code);
+    }
+    friend class Sliced_Replay;
+};
+
+
+// Records that touch different rows can run at the same time.
+// Give each record a level: one more than the level of the last record
+// that wrote the rows it reads, or that read or wrote the row it writes.
+// All records of a level (a "wavefront") are independent, so the
+// participating threads split each wavefront, and wait for it to be
+// complete before starting the next one.
+// The calling thread always participates, so this works even if all
+// the pool threads are busy: pool jobs that start late just find
+// less (or no) work left.
+class RAPTORQ_LOCAL Wavefront_Replay
+{
+public:
+    Wavefront_Replay (Symbol_Mtx &D, std::vector<const uint32_t*> &&records,
+                                        std::vector<uint32_t> &&wave_start)
+        : _D (D), _records (std::move (records)),
+                _wave_start (std::move (wave_start)),
+                _next (new std::atomic<uint32_t>[_wave_start.size() - 1]),
+                _done (new std::atomic<uint32_t>[_wave_start.size() - 1])
+    {
+        for (size_t wave = 0; wave + 1 < _wave_start.size(); ++wave) {
+            _next[wave] = 0;
+            _done[wave] = 0;
+        }
+        _first_open = 0;
+    }
+    Wavefront_Replay() = delete;
+    Wavefront_Replay (const Wavefront_Replay&) = delete;
+    Wavefront_Replay& operator= (const Wavefront_Replay&) = delete;
+    Wavefront_Replay (Wavefront_Replay&&) = delete;
+    Wavefront_Replay& operator= (Wavefront_Replay&&) = delete;
+    ~Wavefront_Replay() = default;
+
+    void run (const uint32_t threads)
+    {
+        const uint32_t waves = static_cast<uint32_t> (_wave_start.size() - 1);
+        for (uint32_t wave = _first_open; wave < waves; ++wave) {
+            const uint32_t from = _wave_start[wave];
+            const uint32_t size = _wave_start[wave + 1] - from;
+            const uint32_t grain = std::max (static_cast<uint32_t> (1),
+                                                        size / (4 * threads));
+            for (;;) {
+                const uint32_t idx = _next[wave].fetch_add (grain);
+                if (idx >= size)
+                    break;
+                const uint32_t to = std::min (idx + grain, size);
+                for (uint32_t rec = idx; rec < to; ++rec)
+                    Schedule::run (_D, _records[from + rec]);
+                _done[wave].fetch_add (to - idx, std::memory_order_release);
+            }
+            while (_done[wave].load (std::memory_order_acquire) < size)
+                std::this_thread::yield();
+            if (_first_open < wave + 1)
+                _first_open = wave + 1;
+        }
+    }
+
+private:
+    Symbol_Mtx &_D;
+    const std::vector<const uint32_t*> _records;   // ordered by wave
+    const std::vector<uint32_t> _wave_start;
+    std::unique_ptr<std::atomic<uint32_t>[]> _next, _done;
+    std::atomic<uint32_t> _first_open;
+};
+
+class RAPTORQ_LOCAL Wavefront_Work final : public RFC6330__v1::Impl::Pool_Work
+{
+public:
+    Wavefront_Work (const std::shared_ptr<Wavefront_Replay> &replay,
+                                                        const uint32_t threads)
+        : _replay (replay), _threads (threads) {}
+    RFC6330__v1::Work_Exit_Status do_work (RaptorQ__v1::Work_State *state)
+                                                                    override
+    {
+        RQ_UNUSED (state);
+        _replay->run (_threads);
+        return RFC6330__v1::Work_Exit_Status::DONE;
+    }
+    ~Wavefront_Work() override {}
+private:
+    const std::shared_ptr<Wavefront_Replay> _replay;
+    const uint32_t _threads;
+};
+
+// run the records before the first SWAP or REORDER in parallel, if it
+// is worth it. returns the first record that still has to be run.
+inline const uint32_t* Schedule::replay_parallel (Symbol_Mtx &D) const
+{
+    const uint32_t *code = _code.data();
+    const uint32_t *end = code + _code.size();
+    if (D.stride() < min_parallel_stride)
+        return code;
+    // waiting threads spin: never use more threads than cores.
+    const uint32_t cores = std::thread::hardware_concurrency();
+    if (cores < 2)
+        return code;
+    const uint32_t helpers = std::min (cores - 1, static_cast<uint32_t> (
+                            RFC6330__v1::Impl::Thread_Pool::get().size()));
+
+    std::vector<const uint32_t*> records;
+    std::vector<uint32_t> level;
+    std::vector<uint32_t> last_write (_in_rows, 0), last_read (_in_rows, 0);
+    uint32_t waves = 0;
+    size_t rows_used = 0;
+    for (; code != end; code += record_words (code)) {
+        const Record type = static_cast<Record> (*code & 0xFF);
+        if (type == Record::SWAP || type == Record::REORDER)
+            break;
+        const uint32_t dst = code[1];
+        const uint32_t *src = code + 2;
+        uint32_t sources = 1;
+        if (type == Record::DIV) {
+            sources = 0;
+        } else if (type == Record::ACCUM) {
+            src = code + 3;
+            sources = code[2];
+        }
+        uint32_t lvl = std::max (last_write[dst], last_read[dst]) + 1;
+        for (uint32_t s = 0; s < sources; ++s)
+            lvl = std::max (lvl, last_write[src[s]] + 1);
+        last_write[dst] = lvl;
+        for (uint32_t s = 0; s < sources; ++s)
+            last_read[src[s]] = std::max (last_read[src[s]], lvl);
+        records.push_back (code);
+        level.push_back (lvl);
+        waves = std::max (waves, lvl);
+        rows_used += 1 + sources;
+    }
+    if (waves == 0 || (rows_used * D.stride()) / waves < min_wave_bytes)
+        return _code.data();
+
+    // sort the records by level, keeping their order in each level
+    std::vector<uint32_t> wave_start (waves + 1, 0);
+    for (const uint32_t lvl : level)
+        ++wave_start[lvl];  // level "lvl" is wave "lvl - 1"
+    for (uint32_t wave = 1; wave <= waves; ++wave)
+        wave_start[wave] += wave_start[wave - 1];
+    std::vector<const uint32_t*> ordered (records.size());
+    std::vector<uint32_t> pos (wave_start.begin(), wave_start.end() - 1);
+    for (size_t rec = 0; rec < records.size(); ++rec)
+        ordered[pos[level[rec] - 1]++] = records[rec];
+
+    auto replay = std::make_shared<Wavefront_Replay> (D, std::move (ordered),
+                                                    std::move (wave_start));
+    for (uint32_t helper = 0; helper < helpers; ++helper) {
+        RFC6330__v1::Impl::Thread_Pool::get().add_work (
+                    std::unique_ptr<RFC6330__v1::Impl::Pool_Work> (
+                                new Wavefront_Work (replay, helpers + 1)));
+    }
+    replay->run (helpers + 1);
+    return code;
+}
+
+// Every record is a row operation with the same scalars for all the
+// columns, so each tile of columns of D can be replayed on its own.
+// Threads take the next tile until there are none left. As with the
+// wavefronts the calling thread participates, and waits for the tiles
+// taken by the others.
+class RAPTORQ_LOCAL Sliced_Replay
+{
+public:
+    Sliced_Replay (const Schedule &schedule, const DenseMtx &D, DenseMtx &C,
+                                                        const uint32_t width)
+        : _schedule (schedule), _D (D), _C (C), _width (width),
+                        _tiles ((static_cast<uint32_t> (D.cols()) + width - 1)
+                                                                    / width)
+    {
+        _next = 0;
+        _done = 0;
+    }
+    Sliced_Replay() = delete;
+    Sliced_Replay (const Sliced_Replay&) = delete;
+    Sliced_Replay& operator= (const Sliced_Replay&) = delete;
+    Sliced_Replay (Sliced_Replay&&) = delete;
+    Sliced_Replay& operator= (Sliced_Replay&&) = delete;
+    ~Sliced_Replay() = default;
+
+    uint32_t tiles() const
+        { return _tiles; }
+
+    void run()
+    {
+        const uint32_t cols = static_cast<uint32_t> (_D.cols());
+        for (;;) {
+            const uint32_t tile = _next.fetch_add (1);
+            if (tile >= _tiles)
+                break;
+            const uint32_t from = tile * _width;
+            const uint32_t width = std::min (_width, cols - from);
+            Symbol_Mtx part (_D, from, width);
+            _schedule.replay_sequential (part);
+            for (uint32_t r = 0; r < part.rows(); ++r)
+                std::memcpy (row_data (_C, r) + from, part.row (r), width);
+            _done.fetch_add (1, std::memory_order_release);
+        }
+    }
+    void wait() const
+    {
+        while (_done.load (std::memory_order_acquire) < _tiles)
+            std::this_thread::yield();
+    }
+
+private:
+    const Schedule &_schedule;
+    const DenseMtx &_D;
+    DenseMtx &_C;
+    const uint32_t _width, _tiles;
+    std::atomic<uint32_t> _next, _done;
+};
+
+class RAPTORQ_LOCAL Sliced_Work final : public RFC6330__v1::Impl::Pool_Work
+{
+public:
+    explicit Sliced_Work (const std::shared_ptr<Sliced_Replay> &replay)
+        : _replay (replay) {}
+    RFC6330__v1::Work_Exit_Status do_work (RaptorQ__v1::Work_State *state)
+                                                                    override
+    {
+        RQ_UNUSED (state);
+        _replay->run();
+        return RFC6330__v1::Work_Exit_Status::DONE;
+    }
+    ~Sliced_Work() override {}
+private:
+    const std::shared_ptr<Sliced_Replay> _replay;
+};
+
+inline DenseMtx Schedule::replay_sliced (const DenseMtx &D) const
+{
+    const uint32_t cols = static_cast<uint32_t> (D.cols());
+    // waiting threads spin: never use more threads than cores.
+    const uint32_t cores = std::max (std::thread::hardware_concurrency(),
+                                                        static_cast<uint32_t> (1));
+    const uint32_t threads = std::min (cores, static_cast<uint32_t> (
+                        RFC6330__v1::Impl::Thread_Pool::get().size() + 1));
+    // the rows of a tile should stay in L2, but there should be at least
+    // a tile for each thread
+    size_t width = std::max (static_cast<size_t> (min_tile_cols),
+                                                        l2_bytes / _in_rows);
+    width = std::min (width, (static_cast<size_t> (cols) + threads - 1) /
+                                                                    threads);
+    width = ((width + 63) / 64) * 64;
+
+    DenseMtx C (_out_rows, cols);
+    auto replay = std::make_shared<Sliced_Replay> (*this, D, C,
+                                            static_cast<uint32_t> (width));
+    const uint32_t helpers = std::min (threads - 1, replay->tiles() - 1);
+    for (uint32_t helper = 0; helper < helpers; ++helper) {
+        RFC6330__v1::Impl::Thread_Pool::get().add_work (
+                    std::unique_ptr<RFC6330__v1::Impl::Pool_Work> (
+                                                new Sliced_Work (replay)));
+    }
+    replay->run();
+    replay->wait();
+    return C;
+}
+
+// Peephole pass on the compiled schedule.
+// - swaps and reorders only rename rows: track the renaming and work on
+//   the storage rows, so that only one final REORDER is left.
+// - consecutive DIVs of the same row become one.
+//   We do not fold DIVs in the scalars of the following ADD_MULs:
+//   there are very few of them, and most ADD_MULs have scalar 1,
+//   which is just a xor: folding would make them real multiplications.
+// - operations on rows that never reach the output are dropped.
+// - consecutive ADD_MULs into the same row become a single ACCUM,
+//   with the repeated sources merged.
+inline void Schedule::optimize()
+{
+    struct Step {
+        Record type;
+        uint32_t dst, src;
+        Octet scalar;
+    };
+    std::vector<Step> steps;
+    std::vector<uint32_t> storage (_in_rows); // row -> storage row
+    for (uint32_t r = 0; r < _in_rows; ++r)
+        storage[r] = r;
+
+    const uint32_t *code = _code.data();
+    const uint32_t *end = code + _code.size();
+    while (code != end) {
+        const Octet scalar = Octet (static_cast<uint8_t> (*code >> 8));
+        switch (static_cast<Record> (*code & 0xFF)) {
+        case Record::SWAP:
+            std::swap (storage[code[1]], storage[code[2]]);
+            code += 3;
+            break;
+        case Record::ADD_MUL: {
+            if (scalar != 0) {
+                steps.push_back ({Record::ADD_MUL, storage[code[1]],
+                                                    storage[code[2]], scalar});
+            }
+            code += 3;
+            break;
+        }
+        case Record::DIV:
+            steps.push_back ({Record::DIV, storage[code[1]], 0, scalar});
+            code += 2;
+            break;
+        case Record::REORDER: {
+            std::vector<uint32_t> new_storage (code[1]);
+            for (uint32_t r = 0; r < code[1]; ++r)
+                new_storage[r] = storage[code[2 + r]];
+            storage.swap (new_storage);
+            code += 2 + code[1];
+            break;
+        }
+        case Record::ACCUM: {
+            const uint8_t *mul = reinterpret_cast<const uint8_t *> (
+                                                        code + 3 + code[2]);
+            for (uint32_t s = 0; s < code[2]; ++s) {
+                if (mul[s] != 0) {
+                    steps.push_back ({Record::ADD_MUL, storage[code[1]],
+                                            storage[code[3 + s]], mul[s]});
+                }
+            }
+            code += accum_words (code[2]);
+            break;
+        }
+        }
+    }
+    std::vector<bool> live (_in_rows, false);
+    for (const uint32_t row : storage)
+        live[row] = true;
+
+    // only keep what ends up in the output rows
+    std::vector<bool> keep (steps.size(), false);
+    for (size_t idx = steps.size(); idx > 0; --idx) {
+        const Step &step = steps[idx - 1];
+        if (!live[step.dst])
+            continue;
+        keep[idx - 1] = true;
+        if (step.type == Record::ADD_MUL)
+            live[step.src] = true;
+    }
+
+    std::vector<uint32_t> out;
+    out.reserve (_code.size());
+    // position of each source in the current ACCUM, if any
+    std::vector<uint32_t> term_of (_in_rows, 0xFFFFFFFF);
+    std::vector<uint32_t> src;
+    std::vector<uint8_t> mul;
+    for (size_t idx = 0; idx < steps.size(); ++idx) {
+        if (!keep[idx])
+            continue;
+        const Step &step = steps[idx];
+        if (step.type == Record::DIV) {
+            Octet scalar = step.scalar;
+            for (; idx + 1 < steps.size(); ++idx) {
+                if (!keep[idx + 1])
+                    continue;
+                if (steps[idx + 1].type != Record::DIV ||
+                                            steps[idx + 1].dst != step.dst) {
+                    break;
+                }
+                scalar *= steps[idx + 1].scalar;
+            }
+            out.push_back (header (Record::DIV, scalar));
+            out.push_back (step.dst);
+            continue;
+        }
+        src.clear();
+        mul.clear();
+        size_t next = idx;
+        for (; next < steps.size(); ++next) {
+            if (!keep[next])
+                continue;
+            if (steps[next].type != Record::ADD_MUL ||
+                                                steps[next].dst != step.dst) {
+                break;
+            }
+            const uint32_t row = steps[next].src;
+            if (term_of[row] == 0xFFFFFFFF) {
+                term_of[row] = static_cast<uint32_t> (src.size());
+                src.push_back (row);
+                mul.push_back (static_cast<uint8_t> (steps[next].scalar));
+            } else {
+                mul[term_of[row]] ^= static_cast<uint8_t> (steps[next].scalar);
+            }
+        }
+        idx = next - 1;
+        // drop the sources that cancelled out
+        uint32_t terms = 0;
+        for (uint32_t s = 0; s < src.size(); ++s) {
+            term_of[src[s]] = 0xFFFFFFFF;
+            if (mul[s] == 0)
+                continue;
+            src[terms] = src[s];
+            mul[terms] = mul[s];
+            ++terms;
+        }
+        if (terms == 0)
+            continue;
+        if (terms == 1) {
+            out.push_back (header (Record::ADD_MUL, Octet (mul[0])));
+            out.push_back (step.dst);
+            out.push_back (src[0]);
+            continue;
+        }
+        const size_t from = out.size();
+        out.resize (from + accum_words (terms), 0);
+        out[from] = header (Record::ACCUM, Octet (0));
+        out[from + 1] = step.dst;
+        out[from + 2] = terms;
+        std::copy (src.begin(), src.begin() + terms, out.begin() + from + 3);
+        std::memcpy (out.data() + from + 3 + terms, mul.data(), terms);
+    }
+
+    bool identity = storage.size() == _in_rows;
+    for (uint32_t r = 0; identity && r < storage.size(); ++r)
+        identity = storage[r] == r;
+    if (!identity) {
+        out.push_back (header (Record::REORDER, Octet (0)));
+        out.push_back (static_cast<uint32_t> (storage.size()));
+        out.insert (out.end(), storage.begin(), storage.end());
+    }
+    _code.swap (out);
+}
+
+// check that all records are complete and all rows are in range.
+inline bool Schedule::valid() const
+{
+    if (_in_rows == 0)
+        return false;
+    uint32_t rows = _in_rows;
+    size_t idx = 0;
+    while (idx < _code.size()) {
+        const Record type = static_cast<Record> (_code[idx] & 0xFF);
+        size_t words;
+        size_t first_row = idx + 1;
+        switch (type) {
+        case Record::SWAP:
+        case Record::ADD_MUL:
+            words = 3;
+            break;
+        case Record::DIV:
+            words = 2;
+            break;
+        case Record::REORDER:
+        case Record::ACCUM:
+            if (idx + 2 >= _code.size())
+                return false;
+            if (type == Record::REORDER) {
+                words = 2 + static_cast<size_t> (_code[idx + 1]);
+                first_row = idx + 2;
+            } else {
+                words = accum_words (_code[idx + 2]);
+            }
+            break;
+        default:
+            return false;
+        }
+        if (idx + words > _code.size())
+            return false;
+        if (type == Record::REORDER) {
+            std::vector<bool> seen (rows, false);
+            for (size_t r = first_row; r < idx + words; ++r) {
+                if (_code[r] >= rows || seen[_code[r]])
+                    return false;
+                seen[_code[r]] = true;
+            }
+            rows = _code[idx + 1];
+        } else {
+            size_t last_row = idx + words;
+            if (type == Record::ACCUM)
+                last_row = idx + 3 + _code[idx + 2];
+            for (size_t r = first_row; r < last_row; ++r) {
+                if (r == idx + 2 && type == Record::ACCUM)
+                    continue;   // that's the count
+                if (_code[r] >= rows)
+                    return false;
+            }
+        }
+        idx += words;
+    }
+    return rows == _out_rows;
+}
+
+}   // namespace Impl
+}   // namespace RaptorQ
@@ -37,35 +37,6 @@ namespace RaptorQ__v1 {
 namespace Impl {
 
 
-// easy compress from/to eigen matrix
-std::vector<uint8_t> RAPTORQ_API Mtx_to_raw (const DenseMtx &mtx);
-inline std::vector<uint8_t> RAPTORQ_API Mtx_to_raw (const DenseMtx &mtx)
-{
-    std::vector<uint8_t> ret;
-    ret.reserve (static_cast<size_t> (mtx.rows() * mtx.cols()));
-    for (uint32_t row = 0; row < static_cast<uint32_t> (mtx.rows()); ++row) {
-        for (uint32_t col = 0; col < static_cast<uint32_t> (mtx.cols()); ++col)
-            ret.emplace_back (static_cast<uint8_t> (mtx (row, col)));
-    }
-    return ret;
-}
-
-DenseMtx RAPTORQ_API raw_to_Mtx (const std::vector<uint8_t> &raw,
-                                                        const uint32_t cols);
-inline DenseMtx RAPTORQ_API raw_to_Mtx (const std::vector<uint8_t> &raw,
-                                                        const uint32_t cols)
-{
-    uint16_t rows = static_cast<uint16_t> (raw.size() / cols);
-    DenseMtx ret (rows, cols);
-    auto raw_it = raw.begin();
-    for (uint32_t row = 0; row < rows; ++row) {
-        for (uint32_t col = 0; col < cols; ++col, ++raw_it)
-            ret (row, col) = *raw_it;
-    }
-    return ret;
-}
-
-
 // TODO: keys and search: we might be able to decode things without using
 // all repair symbols! so the cached mtx could have less symbols than the
 // working one
@@ -153,9 +124,6 @@ public:
                             _repair_bitmask.size() == rhs._repair_bitmask.size() &&
                                             _repair_bitmask == rhs._repair_bitmask;
     }
-
-    uint32_t out_size() const
-        { return (_mt_size - _lost) + _repair; }
 };
 
 
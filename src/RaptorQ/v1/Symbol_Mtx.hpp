@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2015-2016, Luca Fulchir<luca@fulchir.it>, All rights reserved.
+ *
+ * This file is part of "libRaptorQ".
+ *
+ * libRaptorQ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * libRaptorQ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * and a copy of the GNU Lesser General Public License
+ * along with libRaptorQ.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "RaptorQ/v1/common.hpp"
+#include "RaptorQ/v1/gf256.hpp"
+#include "RaptorQ/v1/Octet.hpp"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace RaptorQ__v1 {
+namespace Impl {
+
+// Matrix of symbols, used by the solver in place of a DenseMtx.
+// Rows are accessed through a table, so a row swap never moves the
+// (possibly very big) symbol data.
+// Each row starts on a 64 byte boundary and is padded with zeros to a
+// multiple of 64 bytes, so the GF256 kernels always work on full vectors.
+// The padding stays zero with every operation we support.
+class RAPTORQ_LOCAL Symbol_Mtx
+{
+public:
+    Symbol_Mtx() = default;
+    // all zeros
+    Symbol_Mtx (const uint32_t rows, const uint32_t cols)
+        { init (rows, cols); }
+    explicit Symbol_Mtx (const DenseMtx &mtx)
+    {
+        init (static_cast<uint32_t> (mtx.rows()),
+                                        static_cast<uint32_t> (mtx.cols()));
+        for (uint32_t r = 0; r < _rows; ++r)
+            std::memcpy (row (r), row_data (mtx, r), _cols);
+    }
+    // only the columns [from_col, from_col + cols) of "mtx"
+    Symbol_Mtx (const DenseMtx &mtx, const uint32_t from_col,
+                                                        const uint32_t cols)
+    {
+        init (static_cast<uint32_t> (mtx.rows()), cols);
+        for (uint32_t r = 0; r < _rows; ++r)
+            std::memcpy (row (r), row_data (mtx, r) + from_col, _cols);
+    }
+    // the alignment depends on where the buffer is, no copies.
+    Symbol_Mtx (const Symbol_Mtx&) = delete;
+    Symbol_Mtx& operator= (const Symbol_Mtx&) = delete;
+    Symbol_Mtx (Symbol_Mtx&&) = default;
+    Symbol_Mtx& operator= (Symbol_Mtx&&) = default;
+    ~Symbol_Mtx() = default;
+
+    uint32_t rows() const
+        { return _rows; }
+    uint32_t cols() const
+        { return _cols; }
+    // bytes of each row, with the padding
+    size_t stride() const
+        { return _stride; }
+
+    uint8_t* row (const uint32_t r)
+        { return _data.data() + _offset + _row_slot[r] * _stride; }
+    const uint8_t* row (const uint32_t r) const
+        { return _data.data() + _offset + _row_slot[r] * _stride; }
+
+    void set_identity()
+    {
+        for (uint32_t r = 0; r < _rows; ++r) {
+            std::fill (row (r), row (r) + _cols, 0);
+            if (r < _cols)
+                row (r)[r] = 1;
+        }
+    }
+
+    void swap_rows (const uint32_t row_1, const uint32_t row_2)
+        { std::swap (_row_slot[row_1], _row_slot[row_2]); }
+
+    // keep only "size" rows: row "r" becomes the old row from[r].
+    // only the row table is changed.
+    void select_rows (const uint32_t *from, const uint32_t size)
+    {
+        std::vector<size_t> new_slot (size);
+        for (uint32_t r = 0; r < size; ++r)
+            new_slot[r] = _row_slot[from[r]];
+        _row_slot.swap (new_slot);
+        _rows = size;
+    }
+
+    // row dst += row src * scalar
+    void add_mul (const uint32_t dst, const uint32_t src, const Octet scalar)
+        { GF256::add_mul (row (dst), row (src), static_cast<uint8_t> (scalar),
+                                                                    _stride); }
+    // row /= scalar
+    void div (const uint32_t r, const Octet scalar)
+        { GF256::div (row (r), static_cast<uint8_t> (scalar), _stride); }
+
+    // for each "t": row dst[t] += sum (mul[t * src.size() + s] * row src[s])
+    // This is a (dst x src) * (src x cols) product, done one column tile
+    // at a time, so that the source rows stay in cache while we go
+    // through all the destination rows.
+    // dst and src rows must be different.
+    void add_mul_rows (const std::vector<uint32_t> &dst,
+                                        const std::vector<uint32_t> &src,
+                                        const std::vector<uint8_t> &mul)
+    {
+        std::vector<const uint8_t*> in (src.size());
+        for (size_t from = 0; from < _stride; from += tile) {
+            const size_t len = std::min (static_cast<size_t> (tile),
+                                                            _stride - from);
+            for (size_t s = 0; s < src.size(); ++s)
+                in[s] = row (src[s]) + from;
+            for (size_t t = 0; t < dst.size(); ++t) {
+                GF256::add_mul_sum (row (dst[t]) + from, in.data(),
+                                    mul.data() + t * src.size(),
+                                    static_cast<uint32_t> (src.size()), len);
+            }
+        }
+    }
+
+    // row dst += sum (row src[s] * mul[s]). dst must not be in src.
+    void add_mul_sum (const uint32_t dst, const uint32_t *src,
+                                const uint8_t *mul, const uint32_t count)
+    {
+        const uint8_t *in[sum_chunk];
+        for (uint32_t first = 0; first < count; first += sum_chunk) {
+            const uint32_t size = std::min (static_cast<uint32_t> (sum_chunk),
+                                                            count - first);
+            for (uint32_t s = 0; s < size; ++s)
+                in[s] = row (src[first + s]);
+            GF256::add_mul_sum (row (dst), in, mul + first, size, _stride);
+        }
+    }
+
+    // a DenseMtx with the rows in their current order.
+    DenseMtx to_dense() const
+    {
+        DenseMtx ret (_rows, _cols);
+        for (uint32_t r = 0; r < _rows; ++r)
+            std::memcpy (row_data (ret, r), row (r), _cols);
+        return ret;
+    }
+
+private:
+    enum : size_t { alignment = 64,
+                    tile = 4096 };  // bytes of each row in add_mul_rows
+    enum : uint32_t { sum_chunk = 32 }; // sources for each add_mul_sum
+
+    uint32_t _rows = 0, _cols = 0;
+    size_t _stride = 0, _offset = 0;
+    std::vector<uint8_t> _data;
+    std::vector<size_t> _row_slot;      // row -> storage slot
+
+    void init (const uint32_t rows, const uint32_t cols)
+    {
+        _rows = rows;
+        _cols = cols;
+        _stride = ((cols + alignment - 1) / alignment) * alignment;
+        _data.assign (rows * _stride + alignment - 1, 0);
+        const size_t addr = reinterpret_cast<size_t> (_data.data());
+        _offset = (alignment - (addr % alignment)) % alignment;
+        _row_slot.resize (rows);
+        for (uint32_t r = 0; r < rows; ++r)
+            _row_slot[r] = r;
+    }
+};
+
+}   // namespace Impl
+}   // namespace RaptorQ
@@ -0,0 +1,577 @@
+/*
+ * Copyright (c) 2015-2016, Luca Fulchir<luca@fulchir.it>, All rights reserved.
+ *
+ * This file is part of "libRaptorQ".
+ *
+ * libRaptorQ is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * libRaptorQ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * and a copy of the GNU Lesser General Public License
+ * along with libRaptorQ.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "RaptorQ/v1/common.hpp"
+#include "RaptorQ/v1/multiplication.hpp"
+#include "RaptorQ/v1/Octet.hpp"
+#include <cstring>
+#include <Eigen/Core>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define RQ_GF256_X86
+    #include <immintrin.h>
+#endif
+
+namespace RaptorQ__v1 {
+namespace Impl {
+
+using DenseMtx = Eigen::Matrix<Octet, Eigen::Dynamic, Eigen::Dynamic,
+                                                            Eigen::RowMajor>;
+
+// Row kernels for GF(256).
+// Everything we do on a symbol or on a row of the precode matrix
+// comes down to:
+//      dst += src              (add)
+//      dst *= scalar           (mul)
+//      dst += src * scalar     (add_mul)
+// The SIMD versions use the "split nibble" trick: for a fixed scalar,
+//      x * scalar == low[x & 0x0F] ^ high[x >> 4]
+// where low/high are 16-entries tables, so a single byte shuffle
+// multiplies 16, 32 or 64 octets at once.
+// The best implementation is chosen once, at runtime, by looking at the cpu.
+
+class RAPTORQ_LOCAL GF256
+{
+public:
+    static void add (uint8_t *dst, const uint8_t *src, const size_t len)
+        { get()._add (dst, src, len); }
+    static void mul (uint8_t *dst, const uint8_t scalar, const size_t len)
+    {
+        if (scalar == 1)
+            return;
+        if (scalar == 0) {
+            std::memset (dst, 0, len);
+            return;
+        }
+        get()._mul (dst, scalar, len);
+    }
+    static void div (uint8_t *dst, const uint8_t scalar, const size_t len)
+        { mul (dst, oct_inv[scalar], len); }
+    static void add_mul (uint8_t *dst, const uint8_t *src,
+                                    const uint8_t scalar, const size_t len)
+    {
+        if (scalar == 0)
+            return;
+        if (scalar == 1)
+            return get()._add (dst, src, len);
+        get()._add_mul (dst, src, scalar, len);
+    }
+    // dst += sum (src[s] * mul[s]), for s in [0, count).
+    // Like a row of a matrix product: dst is loaded and stored only once
+    // for all the sources, a block at a time. dst must not be in src.
+    static void add_mul_sum (uint8_t *dst, const uint8_t *const *src,
+                                    const uint8_t *mul, const uint32_t count,
+                                                            const size_t len)
+        { get()._add_mul_sum (dst, src, mul, count, len); }
+
+private:
+    using add_t = void (*) (uint8_t*, const uint8_t*, const size_t);
+    using mul_t = void (*) (uint8_t*, const uint8_t, const size_t);
+    using add_mul_t = void (*) (uint8_t*, const uint8_t*, const uint8_t,
+                                                                const size_t);
+    using add_mul_sum_t = void (*) (uint8_t*, const uint8_t *const *,
+                                    const uint8_t*, const uint32_t,
+                                                                const size_t);
+    struct Kernels
+    {
+        add_t _add;
+        mul_t _mul;
+        add_mul_t _add_mul;
+        add_mul_sum_t _add_mul_sum;
+    };
+
+    static const Kernels& get()
+    {
+        static const Kernels kernels = select();
+        return kernels;
+    }
+
+    static Kernels select()
+    {
+        #ifdef RQ_GF256_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports ("avx512bw"))
+            return Kernels {avx512_add, avx512_mul, avx512_add_mul,
+                                                        avx512_add_mul_sum};
+        if (__builtin_cpu_supports ("avx2"))
+            return Kernels {avx2_add, avx2_mul, avx2_add_mul,
+                                                        avx2_add_mul_sum};
+        if (__builtin_cpu_supports ("ssse3"))
+            return Kernels {ssse3_add, ssse3_mul, ssse3_add_mul,
+                                                        each_add_mul_sum};
+        #endif
+        return Kernels {portable_add, portable_mul, portable_add_mul,
+                                                        each_add_mul_sum};
+    }
+
+    static uint8_t mul_octet (const uint8_t a, const uint8_t b)
+        { return oct_mul[a][b]; }
+
+    static void nibble_tables (const uint8_t scalar, uint8_t *low,
+                                                                uint8_t *high)
+    {
+        std::memcpy (low, oct_mul_low[scalar].data(), 16);
+        std::memcpy (high, oct_mul_high[scalar].data(), 16);
+    }
+
+    ///////////////////////
+    // portable, 64 bits at a time
+    ///////////////////////
+
+    // multiply the 8 octets in "word" by "scalar": shift and add,
+    // reducing each octet on its own with the rfc6330 polynomial.
+    static uint64_t mul_word (uint64_t word, uint8_t scalar)
+    {
+        uint64_t res = 0;
+        while (scalar != 0) {
+            if ((scalar & 1) != 0)
+                res ^= word;
+            scalar = static_cast<uint8_t> (scalar >> 1);
+            const uint64_t overflow = (word >> 7) & 0x0101010101010101;
+            word = ((word & 0x7F7F7F7F7F7F7F7F) << 1) ^ (overflow * 0x1D);
+        }
+        return res;
+    }
+
+    static void portable_add (uint8_t *dst, const uint8_t *src,
+                                                            const size_t len)
+    {
+        size_t idx = 0;
+        for (; idx + sizeof(uint64_t) <= len; idx += sizeof(uint64_t)) {
+            uint64_t a, b;
+            std::memcpy (&a, dst + idx, sizeof(uint64_t));
+            std::memcpy (&b, src + idx, sizeof(uint64_t));
+            a ^= b;
+            std::memcpy (dst + idx, &a, sizeof(uint64_t));
+        }
+        for (; idx < len; ++idx)
+            dst[idx] ^= src[idx];
+    }
+
+    static void portable_mul (uint8_t *dst, const uint8_t scalar,
+                                                            const size_t len)
+    {
+        size_t idx = 0;
+        for (; idx + sizeof(uint64_t) <= len; idx += sizeof(uint64_t)) {
+            uint64_t a;
+            std::memcpy (&a, dst + idx, sizeof(uint64_t));
+            a = mul_word (a, scalar);
+            std::memcpy (dst + idx, &a, sizeof(uint64_t));
+        }
+        for (; idx < len; ++idx)
+            dst[idx] = mul_octet (dst[idx], scalar);
+    }
+
+    static void portable_add_mul (uint8_t *dst, const uint8_t *src,
+                                    const uint8_t scalar, const size_t len)
+    {
+        size_t idx = 0;
+        for (; idx + sizeof(uint64_t) <= len; idx += sizeof(uint64_t)) {
+            uint64_t a, b;
+            std::memcpy (&a, dst + idx, sizeof(uint64_t));
+            std::memcpy (&b, src + idx, sizeof(uint64_t));
+            a ^= mul_word (b, scalar);
+            std::memcpy (dst + idx, &a, sizeof(uint64_t));
+        }
+        for (; idx < len; ++idx)
+            dst[idx] ^= mul_octet (src[idx], scalar);
+    }
+
+    // one source at a time, with the selected add_mul.
+    // also used for the tails of the blocked versions.
+    static void each_add_mul_sum (uint8_t *dst, const uint8_t *const *src,
+                                    const uint8_t *mul, const uint32_t count,
+                                                            const size_t len)
+    {
+        for (uint32_t s = 0; s < count; ++s)
+            add_mul (dst, src[s], mul[s], len);
+    }
+    static void each_add_mul_sum (uint8_t *dst, const uint8_t *const *src,
+                                    const size_t offset, const uint8_t *mul,
+                                    const uint32_t count, const size_t len)
+    {
+        for (uint32_t s = 0; s < count; ++s)
+            add_mul (dst, src[s] + offset, mul[s], len);
+    }
+
+    #ifdef RQ_GF256_X86
+    ///////////////////////
+    // SSSE3, 16 bytes at a time
+    ///////////////////////
+
+    __attribute__((target("ssse3")))
+    static void ssse3_add (uint8_t *dst, const uint8_t *src, const size_t len)
+    {
+        size_t idx = 0;
+        for (; idx + 16 <= len; idx += 16) {
+            const __m128i a = _mm_loadu_si128 (
+                                reinterpret_cast<const __m128i*> (dst + idx));
+            const __m128i b = _mm_loadu_si128 (
+                                reinterpret_cast<const __m128i*> (src + idx));
+            _mm_storeu_si128 (reinterpret_cast<__m128i*> (dst + idx),
+                                                        _mm_xor_si128 (a, b));
+        }
+        portable_add (dst + idx, src + idx, len - idx);
+    }
+
+    __attribute__((target("ssse3")))
+    static __m128i ssse3_mul_vec (const __m128i in, const __m128i low,
+                                    const __m128i high, const __m128i mask)
+    {
+        const __m128i l = _mm_and_si128 (in, mask);
+        const __m128i h = _mm_and_si128 (_mm_srli_epi64 (in, 4), mask);
+        return _mm_xor_si128 (_mm_shuffle_epi8 (low, l),
+                                                _mm_shuffle_epi8 (high, h));
+    }
+
+    __attribute__((target("ssse3")))
+    static void ssse3_mul (uint8_t *dst, const uint8_t scalar,
+                                                            const size_t len)
+    {
+        alignas(16) uint8_t tbl[32];
+        nibble_tables (scalar, tbl, tbl + 16);
+        const __m128i low = _mm_load_si128 (
+                                        reinterpret_cast<const __m128i*> (tbl));
+        const __m128i high = _mm_load_si128 (
+                                reinterpret_cast<const __m128i*> (tbl + 16));
+        const __m128i mask = _mm_set1_epi8 (0x0F);
+        size_t idx = 0;
+        for (; idx + 16 <= len; idx += 16) {
+            const __m128i a = _mm_loadu_si128 (
+                                reinterpret_cast<const __m128i*> (dst + idx));
+            _mm_storeu_si128 (reinterpret_cast<__m128i*> (dst + idx),
+                                            ssse3_mul_vec (a, low, high, mask));
+        }
+        portable_mul (dst + idx, scalar, len - idx);
+    }
+
+    __attribute__((target("ssse3")))
+    static void ssse3_add_mul (uint8_t *dst, const uint8_t *src,
+                                    const uint8_t scalar, const size_t len)
+    {
+        alignas(16) uint8_t tbl[32];
+        nibble_tables (scalar, tbl, tbl + 16);
+        const __m128i low = _mm_load_si128 (
+                                        reinterpret_cast<const __m128i*> (tbl));
+        const __m128i high = _mm_load_si128 (
+                                reinterpret_cast<const __m128i*> (tbl + 16));
+        const __m128i mask = _mm_set1_epi8 (0x0F);
+        size_t idx = 0;
+        for (; idx + 16 <= len; idx += 16) {
+            const __m128i a = _mm_loadu_si128 (
+                                reinterpret_cast<const __m128i*> (dst + idx));
+            const __m128i b = _mm_loadu_si128 (
+                                reinterpret_cast<const __m128i*> (src + idx));
+            _mm_storeu_si128 (reinterpret_cast<__m128i*> (dst + idx),
+                    _mm_xor_si128 (a, ssse3_mul_vec (b, low, high, mask)));
+        }
+        portable_add_mul (dst + idx, src + idx, scalar, len - idx);
+    }
+
+    ///////////////////////
+    // AVX2, 32 bytes at a time
+    ///////////////////////
+
+    __attribute__((target("avx2")))
+    static void avx2_add (uint8_t *dst, const uint8_t *src, const size_t len)
+    {
+        size_t idx = 0;
+        for (; idx + 32 <= len; idx += 32) {
+            const __m256i a = _mm256_loadu_si256 (
+                                reinterpret_cast<const __m256i*> (dst + idx));
+            const __m256i b = _mm256_loadu_si256 (
+                                reinterpret_cast<const __m256i*> (src + idx));
+            _mm256_storeu_si256 (reinterpret_cast<__m256i*> (dst + idx),
+                                                    _mm256_xor_si256 (a, b));
+        }
+        portable_add (dst + idx, src + idx, len - idx);
+    }
+
+    __attribute__((target("avx2")))
+    static __m256i avx2_mul_vec (const __m256i in, const __m256i low,
+                                    const __m256i high, const __m256i mask)
+    {
+        const __m256i l = _mm256_and_si256 (in, mask);
+        const __m256i h = _mm256_and_si256 (_mm256_srli_epi64 (in, 4), mask);
+        return _mm256_xor_si256 (_mm256_shuffle_epi8 (low, l),
+                                                _mm256_shuffle_epi8 (high, h));
+    }
+
+    __attribute__((target("avx2")))
+    static void avx2_mul (uint8_t *dst, const uint8_t scalar, const size_t len)
+    {
+        alignas(16) uint8_t tbl[32];
+        nibble_tables (scalar, tbl, tbl + 16);
+        const __m256i low = _mm256_broadcastsi128_si256 (_mm_load_si128 (
+                                    reinterpret_cast<const __m128i*> (tbl)));
+        const __m256i high = _mm256_broadcastsi128_si256 (_mm_load_si128 (
+                                reinterpret_cast<const __m128i*> (tbl + 16)));
+        const __m256i mask = _mm256_set1_epi8 (0x0F);
+        size_t idx = 0;
+        for (; idx + 32 <= len; idx += 32) {
+            const __m256i a = _mm256_loadu_si256 (
+                                reinterpret_cast<const __m256i*> (dst + idx));
+            _mm256_storeu_si256 (reinterpret_cast<__m256i*> (dst + idx),
+                                            avx2_mul_vec (a, low, high, mask));
+        }
+        portable_mul (dst + idx, scalar, len - idx);
+    }
+
+    __attribute__((target("avx2")))
+    static void avx2_add_mul (uint8_t *dst, const uint8_t *src,
+                                    const uint8_t scalar, const size_t len)
+    {
+        alignas(16) uint8_t tbl[32];
+        nibble_tables (scalar, tbl, tbl + 16);
+        const __m256i low = _mm256_broadcastsi128_si256 (_mm_load_si128 (
+                                    reinterpret_cast<const __m128i*> (tbl)));
+        const __m256i high = _mm256_broadcastsi128_si256 (_mm_load_si128 (
+                                reinterpret_cast<const __m128i*> (tbl + 16)));
+        const __m256i mask = _mm256_set1_epi8 (0x0F);
+        size_t idx = 0;
+        for (; idx + 32 <= len; idx += 32) {
+            const __m256i a = _mm256_loadu_si256 (
+                                reinterpret_cast<const __m256i*> (dst + idx));
+            const __m256i b = _mm256_loadu_si256 (
+                                reinterpret_cast<const __m256i*> (src + idx));
+            _mm256_storeu_si256 (reinterpret_cast<__m256i*> (dst + idx),
+                    _mm256_xor_si256 (a, avx2_mul_vec (b, low, high, mask)));
+        }
+        portable_add_mul (dst + idx, src + idx, scalar, len - idx);
+    }
+
+    // 128 bytes of dst stay in registers while we go through the sources.
+    // Scalars 0 are skipped and scalars 1 are just a xor. The nibble
+    // tables come straight from the precomputed oct_mul_low/high.
+    __attribute__((target("avx2")))
+    static void avx2_add_mul_sum (uint8_t *dst, const uint8_t *const *src,
+                                    const uint8_t *mul, const uint32_t count,
+                                                            const size_t len)
+    {
+        const __m256i mask = _mm256_set1_epi8 (0x0F);
+        size_t idx = 0;
+        for (; idx + 128 <= len; idx += 128) {
+            __m256i *out = reinterpret_cast<__m256i*> (dst + idx);
+            __m256i a0 = _mm256_loadu_si256 (out);
+            __m256i a1 = _mm256_loadu_si256 (out + 1);
+            __m256i a2 = _mm256_loadu_si256 (out + 2);
+            __m256i a3 = _mm256_loadu_si256 (out + 3);
+            for (uint32_t s = 0; s < count; ++s) {
+                if (mul[s] == 0)
+                    continue;
+                const __m256i *in = reinterpret_cast<const __m256i*> (
+                                                                src[s] + idx);
+                if (mul[s] == 1) {
+                    a0 = _mm256_xor_si256 (a0, _mm256_loadu_si256 (in));
+                    a1 = _mm256_xor_si256 (a1, _mm256_loadu_si256 (in + 1));
+                    a2 = _mm256_xor_si256 (a2, _mm256_loadu_si256 (in + 2));
+                    a3 = _mm256_xor_si256 (a3, _mm256_loadu_si256 (in + 3));
+                    continue;
+                }
+                const __m256i low = _mm256_broadcastsi128_si256 (
+                            _mm_loadu_si128 (reinterpret_cast<const __m128i*> (
+                                            oct_mul_low[mul[s]].data())));
+                const __m256i high = _mm256_broadcastsi128_si256 (
+                            _mm_loadu_si128 (reinterpret_cast<const __m128i*> (
+                                            oct_mul_high[mul[s]].data())));
+                a0 = _mm256_xor_si256 (a0, avx2_mul_vec (
+                            _mm256_loadu_si256 (in), low, high, mask));
+                a1 = _mm256_xor_si256 (a1, avx2_mul_vec (
+                            _mm256_loadu_si256 (in + 1), low, high, mask));
+                a2 = _mm256_xor_si256 (a2, avx2_mul_vec (
+                            _mm256_loadu_si256 (in + 2), low, high, mask));
+                a3 = _mm256_xor_si256 (a3, avx2_mul_vec (
+                            _mm256_loadu_si256 (in + 3), low, high, mask));
+            }
+            _mm256_storeu_si256 (out, a0);
+            _mm256_storeu_si256 (out + 1, a1);
+            _mm256_storeu_si256 (out + 2, a2);
+            _mm256_storeu_si256 (out + 3, a3);
+        }
+        if (idx < len)
+            each_add_mul_sum (dst + idx, src, idx, mul, count, len - idx);
+    }
+
+    ///////////////////////
+    // AVX-512BW, 64 bytes at a time
+    ///////////////////////
+
+    // the nibble tables, repeated in each 128 bit lane
+    static void avx512_tables (const uint8_t scalar, uint8_t *tbl)
+    {
+        nibble_tables (scalar, tbl, tbl + 64);
+        for (uint8_t lane = 1; lane < 4; ++lane) {
+            std::memcpy (tbl + 16 * lane, tbl, 16);
+            std::memcpy (tbl + 64 + 16 * lane, tbl + 64, 16);
+        }
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    static void avx512_add (uint8_t *dst, const uint8_t *src, const size_t len)
+    {
+        size_t idx = 0;
+        for (; idx + 64 <= len; idx += 64) {
+            const __m512i a = _mm512_loadu_si512 (dst + idx);
+            const __m512i b = _mm512_loadu_si512 (src + idx);
+            _mm512_storeu_si512 (dst + idx, _mm512_xor_si512 (a, b));
+        }
+        avx2_add (dst + idx, src + idx, len - idx);
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    static __m512i avx512_mul_vec (const __m512i in, const __m512i low,
+                                    const __m512i high, const __m512i mask)
+    {
+        const __m512i l = _mm512_and_si512 (in, mask);
+        // the masked shift avoids gcc's "_mm512_undefined" warnings
+        const __m512i h = _mm512_and_si512 (
+                                _mm512_maskz_srli_epi64 (0xFF, in, 4), mask);
+        return _mm512_xor_si512 (_mm512_shuffle_epi8 (low, l),
+                                                _mm512_shuffle_epi8 (high, h));
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    static void avx512_mul (uint8_t *dst, const uint8_t scalar,
+                                                            const size_t len)
+    {
+        alignas(64) uint8_t tbl[128];
+        avx512_tables (scalar, tbl);
+        const __m512i low = _mm512_load_si512 (tbl);
+        const __m512i high = _mm512_load_si512 (tbl + 64);
+        const __m512i mask = _mm512_set1_epi8 (0x0F);
+        size_t idx = 0;
+        for (; idx + 64 <= len; idx += 64) {
+            const __m512i a = _mm512_loadu_si512 (dst + idx);
+            _mm512_storeu_si512 (dst + idx,
+                                        avx512_mul_vec (a, low, high, mask));
+        }
+        avx2_mul (dst + idx, scalar, len - idx);
+    }
+
+    __attribute__((target("avx512f,avx512bw")))
+    static void avx512_add_mul (uint8_t *dst, const uint8_t *src,
+                                    const uint8_t scalar, const size_t len)
+    {
+        alignas(64) uint8_t tbl[128];
+        avx512_tables (scalar, tbl);
+        const __m512i low = _mm512_load_si512 (tbl);
+        const __m512i high = _mm512_load_si512 (tbl + 64);
+        const __m512i mask = _mm512_set1_epi8 (0x0F);
+        size_t idx = 0;
+        for (; idx + 64 <= len; idx += 64) {
+            const __m512i a = _mm512_loadu_si512 (dst + idx);
+            const __m512i b = _mm512_loadu_si512 (src + idx);
+            _mm512_storeu_si512 (dst + idx,
+                _mm512_xor_si512 (a, avx512_mul_vec (b, low, high, mask)));
+        }
+        avx2_add_mul (dst + idx, src + idx, scalar, len - idx);
+    }
+
+    // same as avx2_add_mul_sum, with 256 bytes of dst in registers
+    __attribute__((target("avx512f,avx512bw")))
+    static void avx512_add_mul_sum (uint8_t *dst, const uint8_t *const *src,
+                                    const uint8_t *mul, const uint32_t count,
+                                                            const size_t len)
+    {
+        const __m512i mask = _mm512_set1_epi8 (0x0F);
+        size_t idx = 0;
+        for (; idx + 256 <= len; idx += 256) {
+            uint8_t *out = dst + idx;
+            __m512i a0 = _mm512_loadu_si512 (out);
+            __m512i a1 = _mm512_loadu_si512 (out + 64);
+            __m512i a2 = _mm512_loadu_si512 (out + 128);
+            __m512i a3 = _mm512_loadu_si512 (out + 192);
+            for (uint32_t s = 0; s < count; ++s) {
+                if (mul[s] == 0)
+                    continue;
+                const uint8_t *in = src[s] + idx;
+                if (mul[s] == 1) {
+                    a0 = _mm512_xor_si512 (a0, _mm512_loadu_si512 (in));
+                    a1 = _mm512_xor_si512 (a1, _mm512_loadu_si512 (in + 64));
+                    a2 = _mm512_xor_si512 (a2, _mm512_loadu_si512 (in + 128));
+                    a3 = _mm512_xor_si512 (a3, _mm512_loadu_si512 (in + 192));
+                    continue;
+                }
+                const __m512i low = _mm512_maskz_broadcast_i32x4 (0xFFFF,
+                            _mm_loadu_si128 (reinterpret_cast<const __m128i*> (
+                                            oct_mul_low[mul[s]].data())));
+                const __m512i high = _mm512_maskz_broadcast_i32x4 (0xFFFF,
+                            _mm_loadu_si128 (reinterpret_cast<const __m128i*> (
+                                            oct_mul_high[mul[s]].data())));
+                a0 = _mm512_xor_si512 (a0, avx512_mul_vec (
+                            _mm512_loadu_si512 (in), low, high, mask));
+                a1 = _mm512_xor_si512 (a1, avx512_mul_vec (
+                            _mm512_loadu_si512 (in + 64), low, high, mask));
+                a2 = _mm512_xor_si512 (a2, avx512_mul_vec (
+                            _mm512_loadu_si512 (in + 128), low, high, mask));
+                a3 = _mm512_xor_si512 (a3, avx512_mul_vec (
+                            _mm512_loadu_si512 (in + 192), low, high, mask));
+            }
+            _mm512_storeu_si512 (out, a0);
+            _mm512_storeu_si512 (out + 64, a1);
+            _mm512_storeu_si512 (out + 128, a2);
+            _mm512_storeu_si512 (out + 192, a3);
+        }
+        if (idx < len)
+            each_add_mul_sum (dst + idx, src, idx, mul, count, len - idx);
+    }
+    #endif
+};
+
+///
+/// helpers for the row-major DenseMtx. Octet is just an uint8_t,
+/// so a row is a contiguous array of bytes.
+///
+
+static_assert (sizeof(Octet) == sizeof(uint8_t), "RQ: Octet has padding?");
+
+inline uint8_t* row_data (DenseMtx &mtx, const int64_t row)
+    { return reinterpret_cast<uint8_t*> (mtx.row (row).data()); }
+inline const uint8_t* row_data (const DenseMtx &mtx, const int64_t row)
+    { return reinterpret_cast<const uint8_t*> (mtx.row (row).data()); }
+
+// mtx.row (dst) += src_mtx.row (src)
+inline void row_add (DenseMtx &mtx, const int64_t dst,
+                                    const DenseMtx &src_mtx, const int64_t src)
+{
+    GF256::add (row_data (mtx, dst), row_data (src_mtx, src),
+                                            static_cast<size_t> (mtx.cols()));
+}
+
+// mtx.row (dst) += mtx.row (src) * scalar
+inline void row_add_mul (DenseMtx &mtx, const int64_t dst, const int64_t src,
+                                                        const Octet scalar)
+{
+    GF256::add_mul (row_data (mtx, dst), row_data (mtx, src),
+                                            static_cast<uint8_t> (scalar),
+                                            static_cast<size_t> (mtx.cols()));
+}
+
+// mtx.row (row) /= scalar
+inline void row_div (DenseMtx &mtx, const int64_t row, const Octet scalar)
+{
+    GF256::div (row_data (mtx, row), static_cast<uint8_t> (scalar),
+                                            static_cast<size_t> (mtx.cols()));
+}
+
+}   // namespace Impl
+}   // namespace RaptorQ
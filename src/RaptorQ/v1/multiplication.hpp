@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include "RaptorQ/v1/common.hpp"
 #include <cstddef>
 #include <cstdint>
 #include <array>
@@ -84,6 +85,95 @@ static const std::array<uint8_t, 255> oct_log = {
     89, 95,176,156,169,160, 81, 11,245, 22,235,122,117, 44,215, 79,
    174,213,233,230,231,173,232,116,214,244,234,168, 80, 88,175};
 
+///
+/// Full tables, generated at compile time from the rfc6330 polynomial:
+///     x^8 + x^4 + x^3 + x^2 + 1
+///
+
+template <size_t... Idx>
+struct RAPTORQ_LOCAL Idx_Seq {};
+template <size_t N, size_t... Idx>
+struct RAPTORQ_LOCAL Make_Idx_Seq : Make_Idx_Seq<N - 1, N - 1, Idx...> {};
+template <size_t... Idx>
+struct RAPTORQ_LOCAL Make_Idx_Seq<0, Idx...> { using type = Idx_Seq<Idx...>; };
+
+// multiply by alpha (the "x" polynomial)
+constexpr uint8_t gf256_xtime (const uint8_t a)
+{
+    return static_cast<uint8_t> ((a & 0x80) != 0 ? (a << 1) ^ 0x11D : a << 1);
+}
+
+// shift and add, c++11 constexpr can only be recursive
+constexpr uint8_t gf256_mul_rec (const uint8_t a, const uint8_t b,
+                                                            const uint8_t res)
+{
+    return b == 0 ? res : gf256_mul_rec (gf256_xtime (a),
+                                    static_cast<uint8_t> (b >> 1),
+                                    static_cast<uint8_t> ((b & 1) != 0 ?
+                                                            res ^ a : res));
+}
+
+constexpr uint8_t gf256_mul (const uint8_t a, const uint8_t b)
+    { return gf256_mul_rec (a, b, 0); }
+
+constexpr uint8_t gf256_pow (const uint8_t a, const uint8_t exp)
+{
+    return exp == 0 ? 1 : ((exp & 1) != 0 ?
+                    gf256_mul (a, gf256_pow (a, static_cast<uint8_t> (exp - 1))) :
+                    gf256_pow (gf256_mul (a, a), static_cast<uint8_t> (exp / 2)));
+}
+
+// a^254 == a^-1, since a^255 == 1. Also gives 0 for 0.
+constexpr uint8_t gf256_inv (const uint8_t a)
+    { return gf256_pow (a, 254); }
+
+template <size_t... Idx>
+constexpr std::array<uint8_t, 256> gf256_mul_row (const uint8_t a,
+                                                            Idx_Seq<Idx...>)
+    { return {{ gf256_mul (a, static_cast<uint8_t> (Idx))... }}; }
+
+template <size_t... Idx>
+constexpr std::array<std::array<uint8_t, 256>, 256> gf256_mul_table (
+                                                            Idx_Seq<Idx...>)
+{
+    return {{ gf256_mul_row (static_cast<uint8_t> (Idx),
+                                        Make_Idx_Seq<256>::type())... }};
+}
+
+// products of "a" with all the values of the low (shift = 0)
+// or high (shift = 4) nibble.
+template <size_t... Idx>
+constexpr std::array<uint8_t, 16> gf256_nibble_row (const uint8_t a,
+                                        const uint8_t shift, Idx_Seq<Idx...>)
+{
+    return {{ gf256_mul (a, static_cast<uint8_t> (Idx << shift))... }};
+}
+
+template <size_t... Idx>
+constexpr std::array<std::array<uint8_t, 16>, 256> gf256_nibble_table (
+                                        const uint8_t shift, Idx_Seq<Idx...>)
+{
+    return {{ gf256_nibble_row (static_cast<uint8_t> (Idx), shift,
+                                            Make_Idx_Seq<16>::type())... }};
+}
+
+template <size_t... Idx>
+constexpr std::array<uint8_t, 256> gf256_inv_table (Idx_Seq<Idx...>)
+    { return {{ gf256_inv (static_cast<uint8_t> (Idx))... }}; }
+
+// oct_mul[a][b] == a * b
+constexpr std::array<std::array<uint8_t, 256>, 256> oct_mul =
+                                gf256_mul_table (Make_Idx_Seq<256>::type());
+// a * b == oct_mul_low[a][b & 0x0F] ^ oct_mul_high[a][b >> 4]
+// these are the tables used by the SIMD shuffles.
+constexpr std::array<std::array<uint8_t, 16>, 256> oct_mul_low =
+                            gf256_nibble_table (0, Make_Idx_Seq<256>::type());
+constexpr std::array<std::array<uint8_t, 16>, 256> oct_mul_high =
+                            gf256_nibble_table (4, Make_Idx_Seq<256>::type());
+// oct_inv[a] == 1 / a. oct_inv[0] is 0, but should never be used.
+constexpr std::array<uint8_t, 256> oct_inv =
+                                gf256_inv_table (Make_Idx_Seq<256>::type());
+
 #pragma clang diagnostic pop
 
 }   // namespace Impl
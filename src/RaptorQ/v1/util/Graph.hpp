@@ -21,52 +21,126 @@
 #pragma once
 
 #include "RaptorQ/v1/common.hpp"
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 namespace RaptorQ__v1 {
 namespace Impl {
 
+// union-find of the columns of V, used in phase 1 to track the
+// connected components of the graph whose edges are the rows with
+// exactly two ones (rfc 6330, pg 34).
+// The graph is kept for the whole phase 1:
+//  - find() uses path compression, connect() union by rank.
+//  - nodes are removed when their column leaves V. Components are never
+//    split, we only track how many nodes are still alive in them.
+//  - each component keeps the list of its edges, so that we can quickly
+//    get an edge (row) of the biggest component.
 class RAPTORQ_LOCAL Graph
 {
 public:
+    enum : uint32_t { no_edge = 0xFFFFFFFF };
+
     explicit Graph (const uint16_t size)
+        : _parent (size), _rank (size, 0), _size (size, 1),
+                        _head (size, no_edge), _tail (size, no_edge)
     {
-        _connections.reserve(size);
         for (uint16_t i = 0; i < size; ++i)
-            _connections.emplace_back(1, i);
+            _parent[i] = i;
     }
 
-    void connect (const uint16_t node_a, const uint16_t node_b)
+    // "edge" is the id of the row that connects the two nodes.
+    void connect (const uint16_t node_a, const uint16_t node_b,
+                                                        const uint32_t edge)
     {
-        uint16_t rep_a = find(node_a), rep_b = find(node_b);
+        uint16_t rep_a = find (node_a), rep_b = find (node_b);
+        if (rep_a != rep_b) {
+            if (_rank[rep_a] < _rank[rep_b])
+                std::swap (rep_a, rep_b);
+            if (_rank[rep_a] == _rank[rep_b])
+                ++_rank[rep_a];
+            _parent[rep_b] = rep_a;
+            _size[rep_a] = static_cast<uint16_t> (_size[rep_a] +
+                                                                _size[rep_b]);
+            // concatenate the edge lists
+            if (_head[rep_a] == no_edge) {
+                _head[rep_a] = _head[rep_b];
+                _tail[rep_a] = _tail[rep_b];
+            } else if (_head[rep_b] != no_edge) {
+                _next[_tail[rep_a]] = _head[rep_b];
+                _tail[rep_a] = _tail[rep_b];
+            }
+        }
+        if (_next.size() <= edge)
+            _next.resize (edge + 1, no_edge);
+        _next[edge] = no_edge;
+        if (_head[rep_a] == no_edge) {
+            _head[rep_a] = edge;
+        } else {
+            _next[_tail[rep_a]] = edge;
+        }
+        _tail[rep_a] = edge;
+        _by_size.emplace_back (_size[rep_a], rep_a);
+        std::push_heap (_by_size.begin(), _by_size.end());
+    }
 
-        _connections[rep_a] = { _connections[rep_a].first +
-                                _connections[rep_b].first, rep_a };
-        _connections[rep_b] = _connections[rep_a];
-        if (node_a != rep_a)
-            _connections[node_a] = _connections[rep_a];
-        if (node_b != rep_b)
-            _connections[node_b] = _connections[rep_a];
+    // the node is not part of the graph anymore.
+    void remove (const uint16_t node)
+    {
+        const uint16_t rep = find (node);
+        --_size[rep];
+        if (_head[rep] != no_edge) {
+            _by_size.emplace_back (_size[rep], rep);
+            std::push_heap (_by_size.begin(), _by_size.end());
+        }
+    }
 
-        if (_max_connections < _connections[rep_a].first) {
-            _max_connections = _connections[rep_a].first;
+    // get an edge of the biggest component, ignoring the edges for
+    // which "valid (edge)" is false. Those are dropped from the graph.
+    // no_edge if no valid edge exists.
+    template <typename Valid>
+    uint32_t max_edge (Valid valid)
+    {
+        while (_by_size.size() != 0) {
+            const auto top = _by_size.front();
+            const uint16_t rep = top.second;
+            if (_parent[rep] == rep && _size[rep] == top.first) {
+                while (_head[rep] != no_edge && !valid (_head[rep]))
+                    _head[rep] = _next[_head[rep]];
+                if (_head[rep] != no_edge)
+                    return _head[rep];
+            }
+            // stale size, or no more edges. a new edge will re-add it.
+            std::pop_heap (_by_size.begin(), _by_size.end());
+            _by_size.pop_back();
         }
+        return no_edge;
     }
-    bool is_max (const uint16_t id) const
-        { return _max_connections == _connections[find(id)].first; }
+
 private:
-    uint16_t find (const uint16_t id) const
+    uint16_t find (const uint16_t id)
     {
+        uint16_t rep = id;
+        while (_parent[rep] != rep)
+            rep = _parent[rep];
+        // path compression
         uint16_t tmp = id;
-        while (_connections[tmp].second != tmp)
-            tmp = _connections[tmp].second;
-        return tmp;
+        while (_parent[tmp] != rep) {
+            const uint16_t next = _parent[tmp];
+            _parent[tmp] = rep;
+            tmp = next;
+        }
+        return rep;
     }
 
-    // pair: conected_nodes, representative.
-    // remember make-union-find? use it to track connected components
-    std::vector<std::pair<uint16_t, uint16_t>> _connections;
-    uint16_t _max_connections = 1;
+    std::vector<uint16_t> _parent;
+    std::vector<uint8_t> _rank;
+    std::vector<uint16_t> _size;            // alive nodes, valid for roots
+    std::vector<uint32_t> _head, _tail;     // edge list, valid for roots
+    std::vector<uint32_t> _next;            // next edge in the list
+    // (size, root) max-heap. entries become stale when sizes change.
+    std::vector<std::pair<uint16_t, uint16_t>> _by_size;
 };
 
 }   // namespace Impl
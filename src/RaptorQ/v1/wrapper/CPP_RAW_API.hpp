@@ -71,18 +71,30 @@ public:
 
     bool has_data() const;
     size_t set_data (const Rnd_It &from, const Rnd_It &to);
+    // online encoding, instead of set_data: one source symbol at a time,
+    // in any order. Repair symbols are ready right after the last one.
+    Error add_source_symbol (Rnd_It &from, const Rnd_It to,
+                                                        const uint16_t esi);
     void clear_data();
     bool ready() const;
     void stop();
 
     bool precompute_sync();
     bool compute_sync();
+    // the first "repairs" repair symbols come straight from the source
+    // symbols, with a cached generator matrix. No computation for them.
+    bool set_fixed_repairs (const uint32_t repairs);
     #if __cplusplus >= 201103L || _MSC_VER > 1900
     std::shared_future<Error> precompute();
     std::shared_future<Error> compute();
     #endif
 
     size_t encode (Fwd_It &output, const Fwd_It end, const uint32_t id);
+    // "count" symbols starting from "first_id", each one "stride" bytes
+    // after the previous one in "output" (0: just after it).
+    // returns the number of symbols written.
+    uint32_t encode_range (const uint32_t first_id, const uint32_t count,
+                                        void *output, const size_t stride);
 
 private:
     Impl::Encoder_void _encoder;
@@ -120,6 +132,7 @@ public:
     uint16_t needed_symbols() const;
 
     void set_max_concurrency (const uint16_t max_threads);
+    void set_online (const bool online);
     Decoder_Result decode_once();
 
     Decoder_wait_res poll();
@@ -246,6 +259,10 @@ template <typename Rnd_It, typename Fwd_It>
 bool Encoder<Rnd_It, Fwd_It>::precompute_sync()
     { return _encoder.precompute_sync(); }
 
+template <typename Rnd_It, typename Fwd_It>
+bool Encoder<Rnd_It, Fwd_It>::set_fixed_repairs (const uint32_t repairs)
+    { return _encoder.set_fixed_repairs (repairs); }
+
 template <typename Rnd_It, typename Fwd_It>
 bool Encoder<Rnd_It, Fwd_It>::compute_sync()
     { return _encoder.compute_sync(); }
@@ -272,6 +289,26 @@ size_t Encoder<Rnd_It, Fwd_It>::encode (Fwd_It &output, const Fwd_It end,
     return ret;
 }
 
+template <typename Rnd_It, typename Fwd_It>
+Error Encoder<Rnd_It, Fwd_It>::add_source_symbol (Rnd_It &from,
+                                                        const Rnd_It to,
+                                                        const uint16_t esi)
+{
+    void **_from = reinterpret_cast<void**> (&from);
+    void *_to = reinterpret_cast<void*> (to);
+    auto ret = _encoder.add_source_symbol (_from, _to, esi);
+    Rnd_It *tmp = reinterpret_cast<Rnd_It*> (_from);
+    from = *tmp;
+    return ret;
+}
+
+template <typename Rnd_It, typename Fwd_It>
+uint32_t Encoder<Rnd_It, Fwd_It>::encode_range (const uint32_t first_id,
+                                                        const uint32_t count,
+                                                        void *output,
+                                                        const size_t stride)
+    { return _encoder.encode_range (first_id, count, output, stride); }
+
 ///////////////////
 //// Decoder
 ///////////////////
@@ -363,6 +400,10 @@ template <typename In_It, typename Fwd_It>
 void Decoder<In_It, Fwd_It>::set_max_concurrency (const uint16_t max_threads)
     { return _decoder.set_max_concurrency (max_threads); }
 
+template <typename In_It, typename Fwd_It>
+void Decoder<In_It, Fwd_It>::set_online (const bool online)
+    { return _decoder.set_online (online); }
+
 template <typename In_It, typename Fwd_It>
 Decoder_Result Decoder<In_It, Fwd_It>::decode_once()
     { return _decoder.decode_once(); }
@@ -268,6 +268,52 @@ size_t Encoder_void::set_data (const void* from, const void* to)
     return false;
 }
 
+Error Encoder_void::add_source_symbol (void** from, const void* to,
+                                                        const uint16_t esi)
+{
+    uint8_t *p_8;
+    uint16_t *p_16;
+    uint32_t *p_32;
+    uint64_t *p_64;
+    Error err = Error::INITIALIZATION;
+    if (from == nullptr || to == nullptr)
+        return err;
+    const cast_enc _enc (_encoder);
+    switch (_type) {
+    case RaptorQ_type::RQ_ENC_8:
+        p_8 = reinterpret_cast<uint8_t*> (*from);
+        err = _enc._8->add_source_symbol (p_8,
+                    reinterpret_cast<uint8_t*> (const_cast<void*> (to)), esi);
+        *from = p_8;
+        break;
+    case RaptorQ_type::RQ_ENC_16:
+        p_16 = reinterpret_cast<uint16_t*> (*from);
+        err = _enc._16->add_source_symbol (p_16,
+                    reinterpret_cast<uint16_t*> (const_cast<void*> (to)), esi);
+        *from = p_16;
+        break;
+    case RaptorQ_type::RQ_ENC_32:
+        p_32 = reinterpret_cast<uint32_t*> (*from);
+        err = _enc._32->add_source_symbol (p_32,
+                    reinterpret_cast<uint32_t*> (const_cast<void*> (to)), esi);
+        *from = p_32;
+        break;
+    case RaptorQ_type::RQ_ENC_64:
+        p_64 = reinterpret_cast<uint64_t*> (*from);
+        err = _enc._64->add_source_symbol (p_64,
+                    reinterpret_cast<uint64_t*> (const_cast<void*> (to)), esi);
+        *from = p_64;
+        break;
+    case RaptorQ_type::RQ_DEC_8:
+    case RaptorQ_type::RQ_DEC_16:
+    case RaptorQ_type::RQ_DEC_32:
+    case RaptorQ_type::RQ_DEC_64:
+    case RaptorQ_type::RQ_NONE:
+        break;
+    }
+    return err;
+}
+
 void Encoder_void::clear_data()
 {
     const cast_enc _enc (_encoder);
@@ -354,6 +400,28 @@ bool Encoder_void::precompute_sync()
     return false;
 }
 
+bool Encoder_void::set_fixed_repairs (const uint32_t repairs)
+{
+    const cast_enc _enc (_encoder);
+    switch (_type) {
+    case RaptorQ_type::RQ_ENC_8:
+        return _enc._8->set_fixed_repairs (repairs);
+    case RaptorQ_type::RQ_ENC_16:
+        return _enc._16->set_fixed_repairs (repairs);
+    case RaptorQ_type::RQ_ENC_32:
+        return _enc._32->set_fixed_repairs (repairs);
+    case RaptorQ_type::RQ_ENC_64:
+        return _enc._64->set_fixed_repairs (repairs);
+    case RaptorQ_type::RQ_DEC_8:
+    case RaptorQ_type::RQ_DEC_16:
+    case RaptorQ_type::RQ_DEC_32:
+    case RaptorQ_type::RQ_DEC_64:
+    case RaptorQ_type::RQ_NONE:
+        break;
+    }
+    return false;
+}
+
 bool Encoder_void::compute_sync()
 {
     const cast_enc _enc (_encoder);
@@ -470,6 +538,31 @@ size_t Encoder_void::encode (void** output, const void* end, const uint32_t id)
     return ret;
 }
 
+uint32_t Encoder_void::encode_range (const uint32_t first_id,
+                                                        const uint32_t count,
+                                                        void *output,
+                                                        const size_t stride)
+{
+    const cast_enc _enc (_encoder);
+    switch (_type) {
+    case RaptorQ_type::RQ_ENC_8:
+        return _enc._8->encode_range (first_id, count, output, stride);
+    case RaptorQ_type::RQ_ENC_16:
+        return _enc._16->encode_range (first_id, count, output, stride);
+    case RaptorQ_type::RQ_ENC_32:
+        return _enc._32->encode_range (first_id, count, output, stride);
+    case RaptorQ_type::RQ_ENC_64:
+        return _enc._64->encode_range (first_id, count, output, stride);
+    case RaptorQ_type::RQ_DEC_8:
+    case RaptorQ_type::RQ_DEC_16:
+    case RaptorQ_type::RQ_DEC_32:
+    case RaptorQ_type::RQ_DEC_64:
+    case RaptorQ_type::RQ_NONE:
+        break;
+    }
+    return 0;
+}
+
 
 ////////////////
 //// Decoder
@@ -798,6 +891,27 @@ void Decoder_void::set_max_concurrency (const uint16_t max_threads)
     }
 }
 
+void Decoder_void::set_online (const bool online)
+{
+    const cast_dec _dec (_decoder);
+    switch (_type) {
+    case RaptorQ_type::RQ_DEC_8:
+        return _dec._8->set_online (online);
+    case RaptorQ_type::RQ_DEC_16:
+        return _dec._16->set_online (online);
+    case RaptorQ_type::RQ_DEC_32:
+        return _dec._32->set_online (online);
+    case RaptorQ_type::RQ_DEC_64:
+        return _dec._64->set_online (online);
+    case RaptorQ_type::RQ_ENC_8:
+    case RaptorQ_type::RQ_ENC_16:
+    case RaptorQ_type::RQ_ENC_32:
+    case RaptorQ_type::RQ_ENC_64:
+    case RaptorQ_type::RQ_NONE:
+        break;
+    }
+}
+
 Decoder_Result Decoder_void::decode_once()
 {
     const cast_dec _dec (_decoder);
@@ -65,12 +65,15 @@ public:
 
     bool has_data() const;
     size_t set_data (const void* from, const void* to);
+    Error add_source_symbol (void** from, const void* to,
+                                                        const uint16_t esi);
     void clear_data();
     bool ready() const;
     void stop();
 
     bool precompute_sync();
     bool compute_sync();
+    bool set_fixed_repairs (const uint32_t repairs);
     #if __cplusplus >= 201103L || _MSC_VER > 1900
     // not even going to try and make this C++98
     std::shared_future<Error> precompute();
@@ -79,6 +82,8 @@ public:
 
     // void* will be casted to the right type depending on RaptorQ_type
     size_t encode (void** output, const void* end, const uint32_t id);
+    uint32_t encode_range (const uint32_t first_id, const uint32_t count,
+                                        void *output, const size_t stride);
 
 private:
     RaptorQ_type _type;
@@ -112,6 +117,7 @@ public:
     uint16_t needed_symbols() const;
 
     void set_max_concurrency (const uint16_t max_threads);
+    void set_online (const bool online);
     Decoder_Result decode_once();
 
     struct Decoder_wait_res poll();
@@ -137,6 +137,19 @@ static RaptorQ_Dec_Written v1_decode_bytes (struct RaptorQ_ptr *dec,
                                                         const size_t from_byte,
                                                         const size_t skip);
 
+// encoder-specific, added later
+static uint32_t v1_encode_range (const RaptorQ_ptr *enc,
+                                                    const uint32_t first_id,
+                                                    const uint32_t count,
+                                                    void *output,
+                                                    const size_t stride);
+static RaptorQ_Error v1_add_source_symbol (const RaptorQ_ptr *enc,
+                                                    void **from,
+                                                    const size_t size,
+                                                    const uint16_t esi);
+static bool v1_set_fixed_repairs (const RaptorQ_ptr *enc,
+                                                    const uint32_t repairs);
+
 
 void RaptorQ_free_api (struct RaptorQ_base_api **api)
 {
@@ -204,7 +217,12 @@ RaptorQ_v1::RaptorQ_v1()
     end_of_input (&v1_end_of_input),
     decode_once (&v1_decode_once),
     decode_symbol (&v1_decode_symbol),
-    decode_bytes (&v1_decode_bytes)
+    decode_bytes (&v1_decode_bytes),
+
+    // encoder-specific, added later
+    encode_range (&v1_encode_range),
+    add_source_symbol (&v1_add_source_symbol),
+    set_fixed_repairs (&v1_set_fixed_repairs)
 {}
 
 ///////////////////////////
@@ -1103,6 +1121,135 @@ static size_t v1_encode (const RaptorQ_ptr *enc, void **from, const size_t size,
     return 0;
 }
 
+static uint32_t v1_encode_range (const RaptorQ_ptr *enc,
+                                                    const uint32_t first_id,
+                                                    const uint32_t count,
+                                                    void *output,
+                                                    const size_t stride)
+{
+    if (enc == nullptr || enc->ptr == nullptr || output == nullptr)
+        return 0;
+    switch (enc->type) {
+    case RaptorQ_type::RQ_ENC_8:
+        return reinterpret_cast<
+                            RaptorQ__v1::Impl::Encoder<uint8_t*, uint8_t*>*> (
+                                                enc->ptr)->encode_range (
+                                            first_id, count, output, stride);
+    case RaptorQ_type::RQ_ENC_16:
+        return reinterpret_cast<
+                            RaptorQ__v1::Impl::Encoder<uint16_t*, uint16_t*>*> (
+                                                enc->ptr)->encode_range (
+                                            first_id, count, output, stride);
+    case RaptorQ_type::RQ_ENC_32:
+        return reinterpret_cast<
+                            RaptorQ__v1::Impl::Encoder<uint32_t*, uint32_t*>*> (
+                                                enc->ptr)->encode_range (
+                                            first_id, count, output, stride);
+    case RaptorQ_type::RQ_ENC_64:
+        return reinterpret_cast<
+                            RaptorQ__v1::Impl::Encoder<uint64_t*, uint64_t*>*> (
+                                                enc->ptr)->encode_range (
+                                            first_id, count, output, stride);
+    case RaptorQ_type::RQ_DEC_8:
+    case RaptorQ_type::RQ_DEC_16:
+    case RaptorQ_type::RQ_DEC_32:
+    case RaptorQ_type::RQ_DEC_64:
+    case RaptorQ_type::RQ_NONE:
+        break;
+    }
+    return 0;
+}
+
+
+static RaptorQ_Error v1_add_source_symbol (const RaptorQ_ptr *enc,
+                                                    void **from,
+                                                    const size_t size,
+                                                    const uint16_t esi)
+{
+    if (enc == nullptr || enc->ptr == nullptr ||
+                                        from == nullptr || *from == nullptr)
+        return RaptorQ_Error::RQ_ERR_WRONG_INPUT;
+    uint8_t *f_8;
+    uint16_t *f_16;
+    uint32_t *f_32;
+    uint64_t *f_64;
+    RaptorQ_Error err = RaptorQ_Error::RQ_ERR_NONE;
+    switch (enc->type) {
+    case RaptorQ_type::RQ_ENC_8:
+        f_8 = reinterpret_cast<uint8_t*> (*from);
+        err = static_cast<RaptorQ_Error> (reinterpret_cast<
+                            RaptorQ__v1::Impl::Encoder<uint8_t*, uint8_t*>*> (
+                                    enc->ptr)->add_source_symbol (f_8,
+                                                            f_8 + size, esi));
+        *from = f_8;
+        return err;
+    case RaptorQ_type::RQ_ENC_16:
+        f_16 = reinterpret_cast<uint16_t*> (*from);
+        err = static_cast<RaptorQ_Error> (reinterpret_cast<
+                            RaptorQ__v1::Impl::Encoder<uint16_t*, uint16_t*>*> (
+                                    enc->ptr)->add_source_symbol (f_16,
+                                                            f_16 + size, esi));
+        *from = f_16;
+        return err;
+    case RaptorQ_type::RQ_ENC_32:
+        f_32 = reinterpret_cast<uint32_t*> (*from);
+        err = static_cast<RaptorQ_Error> (reinterpret_cast<
+                            RaptorQ__v1::Impl::Encoder<uint32_t*, uint32_t*>*> (
+                                    enc->ptr)->add_source_symbol (f_32,
+                                                            f_32 + size, esi));
+        *from = f_32;
+        return err;
+    case RaptorQ_type::RQ_ENC_64:
+        f_64 = reinterpret_cast<uint64_t*> (*from);
+        err = static_cast<RaptorQ_Error> (reinterpret_cast<
+                            RaptorQ__v1::Impl::Encoder<uint64_t*, uint64_t*>*> (
+                                    enc->ptr)->add_source_symbol (f_64,
+                                                            f_64 + size, esi));
+        *from = f_64;
+        return err;
+    case RaptorQ_type::RQ_DEC_8:
+    case RaptorQ_type::RQ_DEC_16:
+    case RaptorQ_type::RQ_DEC_32:
+    case RaptorQ_type::RQ_DEC_64:
+    case RaptorQ_type::RQ_NONE:
+        break;
+    }
+    return RaptorQ_Error::RQ_ERR_WRONG_INPUT;
+}
+
+
+static bool v1_set_fixed_repairs (const RaptorQ_ptr *enc,
+                                                    const uint32_t repairs)
+{
+    if (enc == nullptr || enc->ptr == nullptr)
+        return false;
+    switch (enc->type) {
+    case RaptorQ_type::RQ_ENC_8:
+        return (reinterpret_cast<
+                            RaptorQ__v1::Impl::Encoder<uint8_t*, uint8_t*>*> (
+                                    enc->ptr))->set_fixed_repairs (repairs);
+    case RaptorQ_type::RQ_ENC_16:
+        return (reinterpret_cast<
+                            RaptorQ__v1::Impl::Encoder<uint16_t*, uint16_t*>*> (
+                                    enc->ptr))->set_fixed_repairs (repairs);
+    case RaptorQ_type::RQ_ENC_32:
+        return (reinterpret_cast<
+                            RaptorQ__v1::Impl::Encoder<uint32_t*, uint32_t*>*> (
+                                    enc->ptr))->set_fixed_repairs (repairs);
+    case RaptorQ_type::RQ_ENC_64:
+        return (reinterpret_cast<
+                            RaptorQ__v1::Impl::Encoder<uint64_t*, uint64_t*>*> (
+                                    enc->ptr))->set_fixed_repairs (repairs);
+    case RaptorQ_type::RQ_DEC_8:
+    case RaptorQ_type::RQ_DEC_16:
+    case RaptorQ_type::RQ_DEC_32:
+    case RaptorQ_type::RQ_DEC_64:
+    case RaptorQ_type::RQ_NONE:
+        break;
+    }
+    return false;
+}
+
 
 //////////////////////////////
 // Decoder-specific functions
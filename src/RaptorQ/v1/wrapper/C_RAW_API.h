@@ -159,6 +159,26 @@ extern "C"
                                                         const size_t from_byte,
                                                         const size_t skip);
 
+        // encoder-specific, added later
+        // "count" symbols starting from "first_ESI", each one "stride"
+        // bytes after the previous one (0: just after it).
+        // returns the number of symbols written.
+        uint32_t (*const encode_range) (const struct RaptorQ_ptr *enc,
+                                                    const uint32_t first_ESI,
+                                                    const uint32_t count,
+                                                    void *output,
+                                                    const size_t stride);
+        // online encoding, instead of set_data: one source symbol at a
+        // time, in any order. "size" elements of the encoder type.
+        RaptorQ_Error (*const add_source_symbol) (
+                                                const struct RaptorQ_ptr *enc,
+                                                void **from,
+                                                const size_t size,
+                                                const uint16_t esi);
+        // the first "repairs" repair symbols come straight from the
+        // source symbols, with a cached generator matrix.
+        bool (*const set_fixed_repairs) (const struct RaptorQ_ptr *enc,
+                                                    const uint32_t repairs);
     };
 
 